@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+# Minimal stand-in server for testing the RegionBlockUpdate CPE extension
+#
+# Usage:
+#   python3 region_test_server.py [port]
+#   ClassiCube TestUser mppass 127.0.0.1 25565
+#
+# Sends a small flat map, then repeatedly alternates between:
+#   - a RegionFill of a random block over a random cuboid
+#   - a RegionBegin/RegionData pair with a deflate compressed striped pattern
+#   - a RegionBegin with oversized dimensions (width * height * length overflows 32 bits),
+#     which the client must ignore along with the RegionData packets that follow it
+import random, select, socket, struct, sys, time, gzip, zlib
+
+WIDTH, HEIGHT, LENGTH = 64, 64, 64
+OPCODE_HANDSHAKE, OPCODE_PING = 0, 1
+OPCODE_LEVEL_BEGIN, OPCODE_LEVEL_DATA, OPCODE_LEVEL_END = 2, 3, 4
+OPCODE_ADD_ENTITY, OPCODE_MESSAGE = 7, 13
+OPCODE_EXT_INFO, OPCODE_EXT_ENTRY = 16, 17
+OPCODE_REGION_FILL, OPCODE_REGION_BEGIN, OPCODE_REGION_DATA = 56, 57, 58
+REGION_CHUNK_SIZE = 1024
+
+def pad(text):
+    return text.encode('ascii')[:64].ljust(64, b' ')
+
+def recv_exact(conn, size):
+    data = b''
+    while len(data) < size:
+        part = conn.recv(size - len(data))
+        if not part: raise ConnectionError("client disconnected")
+        data += part
+    return data
+
+def send_message(conn, text):
+    conn.sendall(struct.pack('>BB', OPCODE_MESSAGE, 0) + pad(text))
+
+def send_map(conn):
+    blocks = bytearray(WIDTH * HEIGHT * LENGTH)
+    for y in range(HEIGHT // 2):
+        block = 2 if y == HEIGHT // 2 - 1 else 3 # grass on top of dirt
+        beg   = y * WIDTH * LENGTH
+        blocks[beg:beg + WIDTH * LENGTH] = bytes([block]) * (WIDTH * LENGTH)
+
+    data = gzip.compress(struct.pack('>I', len(blocks)) + bytes(blocks))
+    conn.sendall(bytes([OPCODE_LEVEL_BEGIN]))
+    for i in range(0, len(data), 1024):
+        chunk = data[i:i + 1024]
+        percent = (i * 100) // len(data)
+        conn.sendall(struct.pack('>BH', OPCODE_LEVEL_DATA, len(chunk)) + chunk.ljust(1024, b'\0') + bytes([percent]))
+    conn.sendall(struct.pack('>BHHH', OPCODE_LEVEL_END, WIDTH, HEIGHT, LENGTH))
+
+    # Spawn the player in the middle of the map, just above the ground
+    x, y, z = WIDTH * 16, (HEIGHT // 2 + 2) * 32, LENGTH * 16
+    conn.sendall(struct.pack('>Bb', OPCODE_ADD_ENTITY, -1) + pad("Player") + struct.pack('>HHHBB', x, y, z, 0, 0))
+
+def random_cuboid():
+    x1, x2 = sorted(random.randrange(WIDTH)  for _ in range(2))
+    y1, y2 = sorted(random.randrange(HEIGHT // 2, HEIGHT) for _ in range(2))
+    z1, z2 = sorted(random.randrange(LENGTH) for _ in range(2))
+    return x1, y1, z1, x2, y2, z2
+
+def send_region_fill(conn):
+    x1, y1, z1, x2, y2, z2 = random_cuboid()
+    block = random.choice([0, 1, 4, 5, 20, 41])
+    conn.sendall(struct.pack('>B6HB', OPCODE_REGION_FILL, x1, y1, z1, x2, y2, z2, block))
+    send_message(conn, "RegionFill %i,%i,%i to %i,%i,%i with %i" % (x1, y1, z1, x2, y2, z2, block))
+
+def send_region_data(conn, x, y, z, width, height, length, blocks):
+    conn.sendall(struct.pack('>B6H', OPCODE_REGION_BEGIN, x, y, z, width, height, length))
+    comp = zlib.compressobj(9, zlib.DEFLATED, -15) # raw deflate, without zlib header
+    data = comp.compress(blocks) + comp.flush()
+
+    for i in range(0, len(data), REGION_CHUNK_SIZE):
+        chunk = data[i:i + REGION_CHUNK_SIZE]
+        conn.sendall(struct.pack('>BH', OPCODE_REGION_DATA, len(chunk)) + chunk.ljust(REGION_CHUNK_SIZE, b'\0'))
+
+def send_region_pattern(conn):
+    x1, y1, z1, x2, y2, z2 = random_cuboid()
+    width, height, length  = x2 - x1 + 1, y2 - y1 + 1, z2 - z1 + 1
+    blocks = bytearray(width * height * length)
+    i = 0
+
+    # Blocks are in YZX order
+    for y in range(height):
+        for z in range(length):
+            for x in range(width):
+                blocks[i] = 21 + ((x + y + z) % 16) # coloured wool stripes
+                i += 1
+    send_region_data(conn, x1, y1, z1, width, height, length, bytes(blocks))
+    send_message(conn, "RegionData %i,%i,%i size %ix%ix%i" % (x1, y1, z1, width, height, length))
+
+def send_region_oversized(conn):
+    # 1024 * 1024 * 4097 wraps around to 1048576 when multiplied with 32 bit integers
+    send_region_data(conn, 0, 0, 0, 1024, 1024, 4097, bytes(1024 * 1024))
+    send_message(conn, "Oversized RegionBegin sent (should be ignored)")
+
+def handle_client(conn):
+    ident = recv_exact(conn, 131)
+    name  = ident[2:66].decode('ascii').rstrip()
+    print("%s connected (CPE: %s)" % (name, ident[130] == 0x42))
+    if ident[130] != 0x42: raise ConnectionError("client doesn't support CPE")
+
+    conn.sendall(struct.pack('>B', OPCODE_EXT_INFO) + pad("RegionTest server") + struct.pack('>H', 1))
+    conn.sendall(struct.pack('>B', OPCODE_EXT_ENTRY) + pad("RegionBlockUpdate") + struct.pack('>I', 1))
+
+    reply = recv_exact(conn, 67)
+    count = struct.unpack('>H', reply[65:67])[0]
+    exts  = [recv_exact(conn, 69)[1:65].decode('ascii').rstrip() for _ in range(count)]
+    if "RegionBlockUpdate" not in exts: raise ConnectionError("client doesn't support RegionBlockUpdate")
+
+    conn.sendall(struct.pack('>BB', OPCODE_HANDSHAKE, 7) + pad("RegionTest server") + pad("Region update test") + bytes([0x64]))
+    send_map(conn)
+
+    senders = [send_region_fill, send_region_pattern, send_region_fill, send_region_pattern, send_region_oversized]
+    for i in range(1000000):
+        # Client packets aren't needed, so just discard them
+        while select.select([conn], [], [], 0)[0]:
+            if not conn.recv(4096): return
+        conn.sendall(bytes([OPCODE_PING]))
+        senders[i % len(senders)](conn)
+        time.sleep(2)
+
+def main():
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 25565
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.bind(('127.0.0.1', port))
+    server.listen(1)
+    print("Listening on 127.0.0.1:%i" % port)
+
+    while True:
+        conn, _ = server.accept()
+        try:
+            handle_client(conn)
+        except (ConnectionError, OSError) as e:
+            print("Client disconnected: %s" % e)
+        finally:
+            conn.close()
+
+if __name__ == '__main__':
+    main()
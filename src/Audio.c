@@ -224,15 +224,17 @@ static cc_result ProcessZipEntry(const cc_string* path, struct Stream* stream, s
 }
 
 static cc_result Sounds_ExtractZip(const cc_string* path) {
-	struct ZipEntry entries[128];
+	struct ZipIndex index;
 	struct Stream stream;
 	cc_result res;
 
 	res = Stream_OpenFile(&stream, path);
 	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
 
-	res = Zip_Extract(&stream, SelectZipEntry, ProcessZipEntry,
-						entries, Array_Elems(entries));
+	res = ZipIndex_Read(&index, &stream);
+	if (!res) res = ZipIndex_ExtractAll(&index, SelectZipEntry, ProcessZipEntry);
+
+	ZipIndex_Free(&index);
 	if (res) Logger_SysWarn2(res, "extracting", path);
 
 	/* No point logging error for closing readonly file */
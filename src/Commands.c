@@ -17,6 +17,7 @@
 #include "TexturePack.h"
 #include "Options.h"
 #include "Drawer2D.h"
+#include "Formats.h"
 
 #define COMMANDS_PREFIX "/client"
 #define COMMANDS_PREFIX_SPACE "/client "
@@ -62,7 +63,7 @@ static struct ChatCommand* Commands_FindMatch(const cc_string* cmdName) {
 }
 
 static void Commands_PrintDefault(void) {
-	cc_string str; char strBuffer[STRING_SIZE];
+	cc_string str; char strBuffer[STRING_SIZE * 2];
 	struct ChatCommand* cmd;
 	cc_string name;
 
@@ -304,6 +305,80 @@ static struct ChatCommand MotdCommand = {
 	}
 };
 
+static void NetStatsCommand_Print(const char* prefix, struct NetOpcodeStats* stats) {
+	cc_string str; char strBuffer[STRING_SIZE * 2];
+	int i, packets, bytes, handlerUS;
+	cc_uint8 opcode;
+
+	for (i = 0; i < 256; i++) 
+	{
+		if (!stats[i].count) continue;
+		opcode    = (cc_uint8)i;
+		packets   = stats[i].count;
+		bytes     = stats[i].bytes;
+		handlerUS = (int)stats[i].handlerTime;
+
+		String_InitArray(str, strBuffer);
+		String_Format4(&str, "%c opcode %b: &f%i &epackets, &f%i &ebytes", prefix, &opcode, &packets, &bytes);
+		if (handlerUS) String_Format1(&str, ", &f%i &eus in handler", &handlerUS);
+		Chat_Add(&str);
+	}
+}
+
+static void NetStatsCommand_Execute(const cc_string* args, int argsCount) {
+	if (Server.IsSinglePlayer) {
+		Chat_AddRaw("&eThis command can only be used in multiplayer.");
+	} else if (!argsCount) {
+		NetStatsCommand_Print("&eReceived", NetStats.Recv);
+		NetStatsCommand_Print("&eSent",     NetStats.Sent);
+	} else if (String_CaselessEqualsConst(&args[0], "reset")) {
+		NetStats_Reset();
+		Chat_AddRaw("&e/client: &fNetwork statistics reset.");
+	} else if (String_CaselessEqualsConst(&args[0], "hud")) {
+		NetStats.ShowInHUD = !NetStats.ShowInHUD;
+		Chat_AddRaw(NetStats.ShowInHUD ? "&e/client: &fNetwork statistics shown in HUD."
+										: "&e/client: &fNetwork statistics hidden from HUD.");
+	} else {
+		Chat_Add1("&e/client: &cUnrecognised argument &f\"%s\"&c.", &args[0]);
+	}
+}
+
+static struct ChatCommand NetStatsCommand = {
+	"NetStats", NetStatsCommand_Execute,
+	0,
+	{
+		"&a/client netstats",
+		"&eDisplays packets, bytes and handler time per opcode",
+		"&a/client netstats reset",
+		"&eResets the network statistics to 0",
+		"&a/client netstats hud &e- Toggles packet rates in the HUD",
+	}
+};
+
+
+/*########################################################################################################################*
+*------------------------------------------------------MapBenchCommand----------------------------------------------------*
+*#########################################################################################################################*/
+static void MapBenchCommand_Execute(const cc_string* args, int argsCount) {
+	if (!World.Blocks) {
+		Chat_AddRaw("&e/client: &cThere is no map to benchmark."); return;
+	}
+
+	Chat_Add3("&e/client: &fBenchmarking %ix%ix%i map", &World.Width, &World.Height, &World.Length);
+	Map_Benchmark();
+}
+
+static struct ChatCommand MapBenchCommand = {
+	"MapBench", MapBenchCommand_Execute,
+	COMMAND_FLAG_SINGLEPLAYER_ONLY,
+	{
+		"&a/client mapbench",
+		"&eSaves then loads the current map in each map format,",
+		"&e  displaying the speed and size of each format",
+		"&e  and whether the map was unchanged after loading",
+	}
+};
+
 /*#######################################################################################################################*
 *-------------------------------------------------------PlaceCommand-----------------------------------------------------*
 *########################################################################################################################*/
@@ -805,6 +880,8 @@ static void OnInit(void) {
 	Commands_Register(&TeleportCommand);
 	Commands_Register(&ClearDeniedCommand);
 	Commands_Register(&MotdCommand);
+	Commands_Register(&NetStatsCommand);
+	Commands_Register(&MapBenchCommand);
 	Commands_Register(&PlaceCommand);
 	Commands_Register(&BlockEditCommand);
 	Commands_Register(&CuboidCommand);
@@ -247,19 +247,16 @@ static cc_result Huffman_Build(struct HuffmanTable* table, const cc_uint8* bitLe
 
 		/* Compute the accelerated lookup table values for this codeword.
 		* For example, assume len = 4 and codeword = 0100
-		* - Shift it left to be 0100_00000
-		* - Then, for all the indices from 0100_00000 to 0100_11111,
-		*   - bit reverse index, as huffman codes are read backwards
+		* - Bit reverse it to be 0010, as huffman codes are read backwards
+		* - Then, for all the indices from 00000_0010 to 11111_0010,
 		*   - set fast value to specify a 'value' value, and to skip 'len' bits
 		*/
 		if (len <= INFLATE_FAST_BITS) {
 			cc_int16 packed = (cc_int16)((len << INFLATE_FAST_LEN_SHIFT) | value);
 			int codeword = table->firstCodewords[len] + (bl_offsets[len] - table->firstOffsets[len]);
-			codeword <<= (INFLATE_FAST_BITS - len);
 
-			for (j = 0; j < 1 << (INFLATE_FAST_BITS - len); j++, codeword++) {
-				int index = Huffman_ReverseBits(codeword, INFLATE_FAST_BITS);
-				table->fast[index] = packed;
+			for (j = Huffman_ReverseBits(codeword, len); j < 1 << INFLATE_FAST_BITS; j += 1 << len) {
+				table->fast[j] = packed;
 			}
 		}
 		bl_offsets[len]++;
@@ -306,44 +303,26 @@ static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table
 	return -1;
 }
 
-/* Inline the common <= 9 bits case */
-#define Huffman_UNSAFE_Decode(state, table, result) \
-{\
-	Inflate_UNSAFE_EnsureBits(state, INFLATE_MAX_BITS);\
-	packed = table.fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];\
-	if (packed >= 0) {\
-		consumedBits = packed >> INFLATE_FAST_BITS;\
-		Inflate_ConsumeBits(state, consumedBits);\
-		result = packed & 0x1FF;\
-	} else {\
-		result = Huffman_UNSAFE_Decode_Slow(state, &table);\
-	}\
-}
-
-static int Huffman_UNSAFE_Decode_Slow(struct InflateState* state, struct HuffmanTable* table) {
-	cc_uint32 i, j, codeword;
+/* Decodes a huffman code longer than INFLATE_FAST_BITS from the given bits */
+/* Returns -1 if the bits do not form a valid codeword */
+static int Huffman_DecodeSlowBits(struct HuffmanTable* table, cc_uint32 bits, cc_uint32* len) {
+	cc_uint32 i, codeword;
 	int offset;
 
 	/* Slow, bit by bit lookup. Need to reverse order for huffman. */
-	codeword = Inflate_PeekBits(state,       INFLATE_FAST_BITS);
-	codeword = Huffman_ReverseBits(codeword, INFLATE_FAST_BITS);
+	codeword = Huffman_ReverseBits(bits & ((1UL << INFLATE_FAST_BITS) - 1UL), INFLATE_FAST_BITS);
+	bits   >>= INFLATE_FAST_BITS;
 
-	for (i = INFLATE_FAST_BITS + 1, j = INFLATE_FAST_BITS; i < INFLATE_MAX_BITS; i++, j++) {
-		codeword = (codeword << 1) | ((state->Bits >> j) & 1);
+	for (i = INFLATE_FAST_BITS + 1; i < INFLATE_MAX_BITS; i++, bits >>= 1) {
+		codeword = (codeword << 1) | (bits & 1);
 
 		if (codeword < table->endCodewords[i]) {
 			offset = table->firstOffsets[i] + (codeword - table->firstCodewords[i]);
-			Inflate_ConsumeBits(state, i);
+			*len   = i;
 			return table->values[offset];
 		}
 	}
-
-	Inflate_Fail(state, INF_ERR_INVALID_CODE);
-	/* Need to exit the fast decode loop */
-	/* TODO: This means a few garbage bytes can get written */
-	/* to the output, but it probably doesn't matter */
-	state->AvailIn = 0;
-	return 0;
+	return -1;
 }
 
 void Inflate_Init2(struct InflateState* state, struct Stream* source) {
@@ -399,79 +378,129 @@ static const cc_uint8 codelens_order[INFLATE_MAX_CODELENS] = {
 	16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 
 };
 
+/* Most bits needed by one length + distance pair (15 + 5 + 15 + 13) */
+#define INFLATE_FAST_PAIR_BITS 48
+/* Fills the 64 bit buffer with whole bytes (reads at most 8 bytes, when the buffer is empty) */
+#define Inflate_FastRefill() while (numBits <= 56) { bitBuf |= (cc_uint64)(*in++) << numBits; numBits += 8; }
+#define Inflate_FastConsume(bits) bitBuf >>= (bits); numBits -= (bits);
+
+#define Inflate_FastDecode(table, result) \
+	packed = table.fast[bitBuf & ((1UL << INFLATE_FAST_BITS) - 1UL)];\
+	if (packed >= 0) {\
+		consumed = packed >> INFLATE_FAST_LEN_SHIFT;\
+		result   = packed & INFLATE_FAST_VAL_MASK;\
+	} else {\
+		result = Huffman_DecodeSlowBits(&table, (cc_uint32)bitBuf, &consumed);\
+		if (result < 0) { Inflate_Fail(s, INF_ERR_INVALID_CODE); break; }\
+	}\
+	Inflate_FastConsume(consumed);
+
+/* Decodes directly into the output buffer, using a 64 bit wide bit buffer */
+/* The window is only read from for matches that start before this call's output */
 static void Inflate_InflateFast(struct InflateState* s) {
 	/* huffman variables */
-	cc_uint32 lit, len, dist;
-	cc_uint32 bits, lenIdx, distIdx;
-	int packed, consumedBits;
-
-	/* window variables */
+	int lit, distIdx, packed;
+	cc_uint32 len, dist, bits, lenIdx, consumed;
+	cc_uint64 bitBuf;
+	cc_uint32 numBits;
+
+	/* input/output variables */
+	cc_uint8* in;     cc_uint8* inEnd;
+	cc_uint8* out;    cc_uint8* outEnd;
+	cc_uint8* outBeg; cc_uint8* src;
 	cc_uint8* window;
-	cc_uint32 i, curIdx, startIdx;
-	cc_uint32 copyStart, copyLen, partLen;
+	cc_uint32 i, produced, back, winIdx, loaded, partLen;
 
+	bitBuf  = s->Bits;
+	numBits = s->NumBits;
+	in  = s->NextIn;  inEnd  = in  + s->AvailIn;
+	out = s->Output;  outEnd = out + s->AvailOut;
+	outBeg = out;
 	window = s->Window;
-	curIdx = s->WindowIndex;
-	copyStart = s->WindowIndex;
-	copyLen   = 0;
 
-#define INFLATE_FAST_COPY_MAX (INFLATE_WINDOW_SIZE - INFLATE_FASTINF_OUT)
-	while (s->AvailOut >= INFLATE_FASTINF_OUT && s->AvailIn >= INFLATE_FASTINF_IN && copyLen < INFLATE_FAST_COPY_MAX) {
-		Huffman_UNSAFE_Decode(s, s->Table.Lits, lit);
+	/* At least 8 bytes of input must be left, for Inflate_FastRefill */
+	while ((outEnd - out) >= INFLATE_FASTINF_OUT && (inEnd - in) >= 8) {
+		/* Only refill when there might not be enough bits for a whole length/distance pair, */
+		/*  so that runs of literals can be decoded with just one refill */
+		if (numBits < INFLATE_FAST_PAIR_BITS) { Inflate_FastRefill(); }
+		Inflate_FastDecode(s->Table.Lits, lit);
+
+		if (lit < 256) {
+			*out++ = (cc_uint8)lit;
+			continue;
+		} else if (lit == 256) {
+			s->State = Inflate_NextBlockState(s);
+			break;
+		}
 
-		if (lit <= 256) {
-			if (lit < 256) {
-				window[curIdx] = (cc_uint8)lit;
-				s->AvailOut--; copyLen++;
-				curIdx = (curIdx + 1) & INFLATE_WINDOW_MASK;
-			} else {
-				s->State = Inflate_NextBlockState(s);
-				break;
+		lenIdx = lit - 257;
+		bits   = len_bits[lenIdx];
+		len    = len_base[lenIdx] + (cc_uint32)(bitBuf & ((1UL << bits) - 1UL));
+		Inflate_FastConsume(bits);
+
+		Inflate_FastDecode(s->TableDists, distIdx);
+		bits = dist_bits[distIdx];
+		dist = dist_base[distIdx] + (cc_uint32)(bitBuf & ((1UL << bits) - 1UL));
+		Inflate_FastConsume(bits);
+
+		produced = (cc_uint32)(out - outBeg);
+		if (dist > produced) {
+			/* Start of match is before this call's output, so has to come from the window */
+			back   = dist - produced;
+			if (back > INFLATE_WINDOW_SIZE) { Inflate_Fail(s, INF_ERR_INVALID_CODE); break; }
+			winIdx = (s->WindowIndex - back) & INFLATE_WINDOW_MASK;
+
+			for (i = 0; i < back && len; i++, len--) {
+				*out++ = window[(winIdx + i) & INFLATE_WINDOW_MASK];
 			}
+			if (!len) continue;
+		}
+		src = out - dist;
+
+		if (dist == 1) {
+			/* Runs of the same byte are very common (e.g. air in maps) */
+			Mem_Set(out, *src, len);
+		} else if (dist >= len && len >= 16) {
+			Mem_Copy(out, src, len);
 		} else {
-			lenIdx = lit - 257;
-			bits = len_bits[lenIdx];
-			Inflate_UNSAFE_EnsureBits(s, bits);
-			len  = len_base[lenIdx] + Inflate_ReadBits(s, bits);
-
-			Huffman_UNSAFE_Decode(s, s->TableDists, distIdx);
-			bits = dist_bits[distIdx];
-			Inflate_UNSAFE_EnsureBits(s, bits);
-			dist = dist_base[distIdx] + Inflate_ReadBits(s, bits);
-	
-			/* Window infinitely repeats like ...xyz|uvwxyz|uvwxyz|uvw... */
-			/* If start and end don't cross a boundary, can avoid masking index */
-			startIdx = (curIdx - dist) & INFLATE_WINDOW_MASK;
-			if (curIdx >= startIdx && (curIdx + len) < INFLATE_WINDOW_SIZE) {
-				cc_uint8* src = &window[startIdx]; 
-				cc_uint8* dst = &window[curIdx];
-
-				for (i = 0; i < (len & ~0x3); i += 4) {
-					*dst++ = *src++; *dst++ = *src++; *dst++ = *src++; *dst++ = *src++;
-				}
-				for (; i < len; i++) { *dst++ = *src++; }
-			} else {
-				for (i = 0; i < len; i++) {
-					window[(curIdx + i) & INFLATE_WINDOW_MASK] = window[(startIdx + i) & INFLATE_WINDOW_MASK];
-				}
+			/* Overlapping copy, so copying forwards repeats the pattern */
+			for (i = 0; i < (len & ~0x3); i += 4) {
+				out[i + 0] = src[i + 0]; out[i + 1] = src[i + 1]; 
+				out[i + 2] = src[i + 2]; out[i + 3] = src[i + 3];
 			}
-			curIdx = (curIdx + len) & INFLATE_WINDOW_MASK;
-			s->AvailOut -= len; copyLen += len;
+			for (; i < len; i++) { out[i] = src[i]; }
 		}
+		out += len;
 	}
 
-	s->WindowIndex = curIdx;
-	if (!copyLen) return;
-
-	if (copyStart + copyLen < INFLATE_WINDOW_SIZE) {
-		Mem_Copy(s->Output, &s->Window[copyStart], copyLen);
-		s->Output += copyLen;
-	} else {
-		partLen = INFLATE_WINDOW_SIZE - copyStart;
-		Mem_Copy(s->Output, &s->Window[copyStart], partLen);
-		s->Output += partLen;
-		Mem_Copy(s->Output, s->Window, copyLen - partLen);
-		s->Output += (copyLen - partLen);
+	/* Return any unused whole bytes loaded during this call back to the input */
+	loaded  = (cc_uint32)(in - s->NextIn);
+	loaded  = min(loaded, numBits >> 3);
+	in     -= loaded;
+	numBits -= loaded * 8;
+	bitBuf &= ((cc_uint64)1 << numBits) - 1;
+
+	s->Bits     = (cc_uint32)bitBuf;
+	s->NumBits  = numBits;
+	s->NextIn   = in;
+	s->AvailIn  = (cc_uint32)(inEnd - in);
+	s->Output   = out;
+	s->AvailOut = (cc_uint32)(outEnd - out);
+
+	/* Keep the window up to date with the most recent output */
+	produced = (cc_uint32)(out - outBeg);
+	if (produced >= INFLATE_WINDOW_SIZE) {
+		Mem_Copy(window, out - INFLATE_WINDOW_SIZE, INFLATE_WINDOW_SIZE);
+		s->WindowIndex = 0;
+	} else if (produced) {
+		winIdx  = s->WindowIndex;
+		partLen = INFLATE_WINDOW_SIZE - winIdx;
+		partLen = min(partLen, produced);
+
+		Mem_Copy(&window[winIdx], outBeg, partLen);
+		/* Wrap around remainder of copy to start from beginning of window */
+		if (partLen < produced) Mem_Copy(window, outBeg + partLen, produced - partLen);
+		s->WindowIndex = (winIdx + produced) & INFLATE_WINDOW_MASK;
 	}
 }
 
@@ -800,12 +829,23 @@ static const cc_uint16 deflate_dist[31] = {
 	1025,1537,2049,3073,4097,6145,8193,12289,16385,24577,UInt16_MaxValue
 };
 
+/* Settings used for each compression level */
+static const struct DeflateConfig {
+	cc_uint16 maxChain; /* Maximum number of previous matches to check */
+	cc_uint16 goodLen;  /* Only check 1/4 of maxChain when looking for a longer match than this */
+	cc_uint16 lazyLen;  /* Only check if a longer match starts at the next byte when shorter than this */
+	cc_uint16 niceLen;  /* Stop searching for matches once one at least this long is found */
+	cc_bool insertAll;  /* Whether to add every byte of a match to the hash chains */
+} deflate_configs[DEFLATE_LEVEL_COUNT] = {
+	{   4,  8,   0,  32, false }, /* DEFLATE_LEVEL_FAST */
+	{  32,  4,  16, 128, true  }, /* DEFLATE_LEVEL_DEFAULT */
+	{ 256, 32, 258, 258, true  }, /* DEFLATE_LEVEL_MAX */
+};
+
 /* Pushes given bits, but does not write them */
 #define Deflate_PushBits(state, value, bits) state->Bits |= (value) << state->NumBits; state->NumBits += (bits);
 /* Pushes bits of the huffman codeword bits for the given literal, but does not write them */
 #define Deflate_PushLit(state, value) Deflate_PushBits(state, state->LitsCodewords[value], state->LitsLens[value])
-/* Pushes given bits (reversing for huffman code), but does not write them */
-#define Deflate_PushHuff(state, value, bits) Deflate_PushBits(state, Huffman_ReverseBits(value, bits), bits)
 /* Writes given byte to output */
 #define Deflate_WriteByte(state) *state->NextOut++ = state->Bits; state->AvailOut--; state->Bits >>= 8; state->NumBits -= 8;
 /* Flushes bits in buffer to output buffer */
@@ -813,17 +853,122 @@ static const cc_uint16 deflate_dist[31] = {
 
 #define MIN_MATCH_LEN 3
 #define MAX_MATCH_LEN 258
+/* Minimum length of a run of the same byte to encode without searching hash chains */
+#define DEFLATE_MIN_RUN_LEN 16
+
+/* Unaligned 8 byte loads are cheap on these CPUs, so compare 8 bytes at a time */
+#if defined __GNUC__ && (defined __x86_64__ || defined __aarch64__) && !defined CC_BIG_ENDIAN
+#define DEFLATE_WORD_MATCH
+#endif
 
 /* Number of bytes that match (are the same) from a and b */
 static int Deflate_MatchLen(cc_uint8* a, cc_uint8* b, int maxLen) {
 	int i = 0;
-	while (i < maxLen && *a == *b) { i++; a++; b++; }
+#ifdef DEFLATE_WORD_MATCH
+	cc_uint64 x, y;
+	for (; i + 8 <= maxLen; i += 8)
+	{
+		__builtin_memcpy(&x, a + i, 8);
+		__builtin_memcpy(&y, b + i, 8);
+		/* Lowest set bit is in the first byte that differs */
+		if (x != y) return i + (__builtin_ctzll(x ^ y) >> 3);
+	}
+#endif
+	while (i < maxLen && a[i] == b[i]) i++;
 	return i;
 }
 
+struct DeflateTables {
+	/* NOTE: Head/Prev store stream positions (i.e. WindowStart + position in Input), */
+	/*  so that they don't need to be adjusted every time the input window moves along */
+	cc_uint32 Head[DEFLATE_HASH_SIZE];
+	cc_uint32 Prev[DEFLATE_BUFFER_SIZE]; /* Indexed by stream position modulo DEFLATE_BUFFER_SIZE */
+};
+
+static cc_result Deflate_AllocTables(struct DeflateState* state) {
+	if (state->Tables) return 0;
+	state->Tables = (struct DeflateTables*)Mem_TryAllocCleared(1, sizeof(struct DeflateTables));
+	return state->Tables ? 0 : ERR_OUT_OF_MEMORY;
+}
+
+static void Deflate_FreeTables(struct DeflateState* state) {
+	Mem_Free(state->Tables);
+	state->Tables = NULL;
+}
+
 /* Hashes 3 bytes of data */
 static cc_uint32 Deflate_Hash(cc_uint8* src) {
-	return (cc_uint32)((src[0] << 8) ^ (src[1] << 4) ^ (src[2])) & DEFLATE_HASH_MASK;
+	cc_uint32 value = src[0] | (src[1] << 8) | (src[2] << 16);
+	return (cc_uint32)(value * 2654435761UL) >> (32 - DEFLATE_HASH_BITS);
+}
+
+/* Adds the given position in Input to the start of the hash chain */
+static void Deflate_Insert(struct DeflateState* state, cc_uint32 hash, int pos) {
+	struct DeflateTables* tables = state->Tables;
+	cc_uint32 streamPos = state->WindowStart + pos;
+	tables->Prev[streamPos & (DEFLATE_BUFFER_SIZE - 1)] = tables->Head[hash];
+	tables->Head[hash] = streamPos;
+}
+
+/* Finds the longest match (longer than bestLen) for data at cur, starting with the given hash chain entry */
+/* NOTE: Chain entries at or before WindowStart are no longer in Input, so end the chain */
+static int Deflate_FindMatch(struct DeflateState* state, cc_uint32 entry, cc_uint8* cur, int maxLen, int bestLen, int* matchPos) {
+	const struct DeflateConfig* cfg = &deflate_configs[state->Level];
+	cc_uint32 windowStart = state->WindowStart;
+	int depth, len, maxChain = cfg->maxChain;
+	cc_uint8* match;
+	*matchPos = 0;
+	if (bestLen >= cfg->goodLen) maxChain >>= 2;
+
+	for (depth = 0; entry > windowStart && depth < maxChain; depth++) {
+		match = state->Input + (entry - windowStart);
+
+		/* Skip entries that can't be longer than the current best match */
+		if (match[bestLen] == cur[bestLen] && match[0] == cur[0]) {
+			len = Deflate_MatchLen(match, cur, maxLen);
+
+			if (len > bestLen) {
+				bestLen   = len;
+				*matchPos = (int)(entry - windowStart);
+				if (len >= cfg->niceLen || len >= maxLen) break;
+			}
+		}
+		entry = state->Tables->Prev[entry & (DEFLATE_BUFFER_SIZE - 1)];
+	}
+	return bestLen;
+}
+
+static int Deflate_LenCode(int len) {
+	int j;
+	for (j = 0; len >= deflate_len[j + 1]; j++);
+	return j;
+}
+
+static int Deflate_DistCode(int dist) {
+	int j;
+	for (j = 0; dist >= deflate_dist[j + 1]; j++);
+	return j;
+}
+
+/* Adds a literal to the list of symbols in the current block */
+static void Deflate_AddLit(struct DeflateState* state, int lit) {
+	state->Symbols[state->SymbolsLength++] = lit;
+	state->LitsFreqs[lit]++;
+	state->NumSymbols++;
+}
+
+/* Adds a length-distance pair to the list of symbols in the current block */
+static void Deflate_AddPair(struct DeflateState* state, int len, int dist) {
+	cc_uint8* sym = &state->Symbols[state->SymbolsLength];
+	sym[0] = len  - MIN_MATCH_LEN;
+	sym[1] = (dist - 1) & 0xFF;
+	sym[2] = (dist - 1) >> 8;
+
+	state->SymbolFlags[state->NumSymbols >> 3] |= 1 << (state->NumSymbols & 7);
+	state->LitsFreqs[257 + Deflate_LenCode(len)]++;
+	state->DistsFreqs[Deflate_DistCode(dist)]++;
+	state->SymbolsLength += 3;
+	state->NumSymbols++;
 }
 
 /* Writes a literal to state->Output */
@@ -835,123 +980,408 @@ static void Deflate_Lit(struct DeflateState* state, int lit) {
 /* Writes a length-distance pair to state->Output */
 static void Deflate_LenDist(struct DeflateState* state, int len, int dist) {
 	int j;
-	/* TODO: Do we actually need the if (len_bits[j]) ????????? does writing 0 bits matter??? */
 
-	for (j = 0; len >= deflate_len[j + 1]; j++);
+	j = Deflate_LenCode(len);
 	Deflate_PushLit(state, j + 257);
+	Deflate_FlushBits(state);
 	if (len_bits[j]) { Deflate_PushBits(state, len - deflate_len[j], len_bits[j]); }
 	Deflate_FlushBits(state);
 
-	for (j = 0; dist >= deflate_dist[j + 1]; j++);
-	Deflate_PushHuff(state, j, 5);
+	j = Deflate_DistCode(dist);
+	Deflate_PushBits(state, state->DistsCodewords[j], state->DistsLens[j]);
+	Deflate_FlushBits(state);
 	if (dist_bits[j]) { Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]); }
 	Deflate_FlushBits(state);
 }
 
-/* Moves "current block" to "previous block", adjusting state if needed. */
-static void Deflate_MoveBlock(struct DeflateState* state) {
+/* Writes all the data in state->Output to the destination stream */
+static cc_result Deflate_FlushOutput(struct DeflateState* state) {
+	cc_result res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	state->NextOut  = state->Output;
+	state->AvailOut = DEFLATE_OUT_SIZE;
+	return res;
+}
+
+/* Calculates optimal huffman code lengths in place, for symbol frequencies sorted in ascending order */
+/* Based on "In-Place Calculation of Minimum-Redundancy Codes" by Moffat and Katajainen */
+static void Deflate_CalcMinRedundancy(int* A, int n) {
+	int root, leaf, next, avail, used, depth;
+	A[0] += A[1]; root = 0; leaf = 2;
+
+	/* Phase 1: Compute weights of internal nodes, replacing frequencies */
+	for (next = 1; next < n - 1; next++) {
+		if (leaf >= n || A[root] < A[leaf]) {
+			A[next] = A[root]; A[root++] = next;
+		} else {
+			A[next] = A[leaf++];
+		}
+
+		if (leaf >= n || (root < next && A[root] < A[leaf])) {
+			A[next] += A[root]; A[root++] = next;
+		} else {
+			A[next] += A[leaf++];
+		}
+	}
+
+	/* Phase 2: Convert parent pointers into depths of internal nodes */
+	A[n - 2] = 0;
+	for (next = n - 3; next >= 0; next--) A[next] = A[A[next]] + 1;
+
+	/* Phase 3: Convert internal node depths into depths of leaves */
+	avail = 1; used = depth = 0; root = n - 2; next = n - 1;
+	while (avail > 0) {
+		while (root >= 0 && A[root] == depth) { used++; root--; }
+		while (avail > used) { A[next--] = depth; avail--; }
+		avail = 2 * used; depth++; used = 0;
+	}
+}
+
+/* Calculates huffman code bit lengths (at most maxBits long) for the given symbol frequencies */
+static void Deflate_BuildLengths(const cc_uint16* freqs, int count, int maxBits, cc_uint8* lens) {
+	int syms[INFLATE_MAX_LITS], A[INFLATE_MAX_LITS];
+	int numCodes[INFLATE_MAX_BITS];
+	int i, j, n = 0, sym;
+	cc_uint32 total;
+
+	for (i = 0; i < count; i++) 
+	{
+		lens[i] = 0;
+		if (!freqs[i]) continue;
+
+		/* Insertion sort by ascending frequency */
+		for (j = n; j > 0 && freqs[syms[j - 1]] > freqs[i]; j--) syms[j] = syms[j - 1];
+		syms[j] = i; n++;
+	}
+
+	if (n == 0) return;
+	if (n == 1) { lens[syms[0]] = 1; return; }
+
+	for (i = 0; i < n; i++) A[i] = freqs[syms[i]];
+	Deflate_CalcMinRedundancy(A, n);
+
+	/* Limit code lengths to maxBits, then fix up the now over-subscribed tree */
+	/*  by lengthening other codes, until the tree is complete again */
+	for (i = 0; i <= maxBits; i++) numCodes[i] = 0;
+	for (i = 0; i < n; i++) numCodes[min(A[i], maxBits)]++;
+
+	total = 0;
+	for (i = 1; i <= maxBits; i++) total += (cc_uint32)numCodes[i] << (maxBits - i);
+
+	while (total > (1UL << maxBits)) {
+		numCodes[maxBits]--;
+		for (i = maxBits - 1; i > 0; i--) 
+		{
+			if (!numCodes[i]) continue;
+			numCodes[i]--; numCodes[i + 1] += 2; break;
+		}
+		total--;
+	}
+
+	/* Least frequent symbols get the longest codes */
+	for (i = maxBits, sym = 0; i > 0; i--) 
+	{
+		for (j = numCodes[i]; j > 0; j--) lens[syms[sym++]] = i;
+	}
+}
+
+/* Constructs the canonical huffman codewords (bit reversed) for the given code bit lengths */
+static void Deflate_BuildCodewords(const cc_uint8* lens, int count, cc_uint16* codewords) {
+	int bl_count[INFLATE_MAX_BITS], next_code[INFLATE_MAX_BITS];
+	int i, code = 0;
+
+	for (i = 0; i < INFLATE_MAX_BITS; i++) bl_count[i] = 0;
+	for (i = 0; i < count; i++) bl_count[lens[i]]++;
+	bl_count[0] = 0;
+
+	for (i = 1; i < INFLATE_MAX_BITS; i++) {
+		code = (code + bl_count[i - 1]) << 1;
+		next_code[i] = code;
+	}
+
+	for (i = 0; i < count; i++) 
+	{
+		if (!lens[i]) continue;
+		codewords[i] = Huffman_ReverseBits(next_code[lens[i]]++, lens[i]);
+	}
+}
+
+/* Run length encodes the bit lengths of the literal and distance codes, */
+/*  using the code length alphabet (0-15 are lengths, 16-18 are repeats) */
+static int Deflate_EncodeCodeLens(const cc_uint8* lens, int count, cc_uint8* syms, cc_uint8* extra, cc_uint16* freqs) {
+	int i = 0, n = 0, run, rep;
+	cc_uint8 len;
+
+	while (i < count) {
+		len = lens[i];
+		for (run = 1; i + run < count && lens[i + run] == len; run++) { }
+		i += run;
+
+		if (len == 0) {
+			while (run >= 11) { 
+				rep = min(run, 138);
+				syms[n] = 18; extra[n++] = rep - 11; run -= rep; 
+			}
+			if (run >= 3) { syms[n] = 17; extra[n++] = run - 3; run = 0; }
+		} else {
+			syms[n] = len; extra[n++] = 0; run--;
+			while (run >= 3) {
+				rep = min(run, 6);
+				syms[n] = 16; extra[n++] = rep - 3; run -= rep;
+			}
+		}
+		for (; run > 0; run--) { syms[n] = len; extra[n++] = 0; }
+	}
+
+	for (i = 0; i < n; i++) freqs[syms[i]]++;
+	return n;
+}
+
+/* Number of bits needed to encode all the symbols in the current block with the given code lengths */
+static cc_uint32 Deflate_CalcDataBits(struct DeflateState* state, const cc_uint8* litLens, const cc_uint8* distLens) {
+	cc_uint32 bits = 0;
 	int i;
-	Mem_Copy(state->Input, state->Input + DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
-	state->InputPosition = DEFLATE_BLOCK_SIZE;
 
-	/* adjust hash table offsets, removing offsets that are no longer in data at all */
-	for (i = 0; i < Array_Elems(state->Head); i++) {
-		state->Head[i] = state->Head[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Head[i] - DEFLATE_BLOCK_SIZE);
+	for (i = 0; i < 286; i++) bits += state->LitsFreqs[i] * litLens[i];
+	for (i = 0; i < 30;  i++) bits += state->DistsFreqs[i] * distLens[i];
+	for (i = 0; i < 29;  i++) bits += state->LitsFreqs[257 + i] * len_bits[i];
+	for (i = 0; i < 30;  i++) bits += state->DistsFreqs[i] * dist_bits[i];
+	return bits;
+}
+
+static const cc_uint8 codelens_extra[INFLATE_MAX_CODELENS] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 2,3,7 };
+
+static void Deflate_WriteDynamicHeader(struct DeflateState* state, const cc_uint8* syms, const cc_uint8* extra, int numSyms,
+									   const cc_uint8* clLens, int numLits, int numDists, int numCodeLens) {
+	cc_uint16 clCodewords[INFLATE_MAX_CODELENS];
+	int i, sym;
+
+	Deflate_PushBits(state, numLits  - 257, 5);
+	Deflate_PushBits(state, numDists - 1,   5);
+	Deflate_PushBits(state, numCodeLens - 4, 4);
+	Deflate_FlushBits(state);
+
+	for (i = 0; i < numCodeLens; i++) 
+	{
+		Deflate_PushBits(state, clLens[codelens_order[i]], 3);
+		Deflate_FlushBits(state);
 	}
-	for (i = 0; i < Array_Elems(state->Prev); i++) {
-		state->Prev[i] = state->Prev[i] < DEFLATE_BLOCK_SIZE ? 0 : (state->Prev[i] - DEFLATE_BLOCK_SIZE);
+
+	Deflate_BuildCodewords(clLens, INFLATE_MAX_CODELENS, clCodewords);
+	for (i = 0; i < numSyms; i++) 
+	{
+		sym = syms[i];
+		Deflate_PushBits(state, clCodewords[sym], clLens[sym]);
+		Deflate_PushBits(state, extra[i], codelens_extra[sym]);
+		Deflate_FlushBits(state);
 	}
 }
 
+/* Writes the data in the current block as-is, without any compression */
+static cc_result Deflate_WriteStored(struct DeflateState* state, cc_uint8* data, int len, cc_bool final) {
+	cc_result res;
+	Deflate_PushBits(state, final, 1);
+	Deflate_PushBits(state, 0, 2); /* block type STORED */
+	Deflate_FlushBits(state);
+
+	/* Stored blocks start at the next byte boundary */
+	if (state->NumBits) { Deflate_PushBits(state, 0, 8 - state->NumBits); }
+	Deflate_FlushBits(state);
+
+	Deflate_PushBits(state, len, 16);
+	Deflate_FlushBits(state);
+	Deflate_PushBits(state, len ^ 0xFFFF, 16);
+	Deflate_FlushBits(state);
+
+	if ((res = Deflate_FlushOutput(state))) return res;
+	return Stream_Write(state->Dest, data, len);
+}
+
+/* Writes the symbols in the current block as either a stored, fixed huffman, */
+/*  or dynamic huffman block (whichever produces the smallest output) */
+static cc_result Deflate_WriteBlock(struct DeflateState* state, cc_uint8* data, int len, cc_bool final) {
+	cc_uint8 litLens[INFLATE_MAX_LITS] = { 0 }, distLens[INFLATE_MAX_DISTS] = { 0 };
+	cc_uint8 lens[INFLATE_MAX_LITS_DISTS], clLens[INFLATE_MAX_CODELENS];
+	cc_uint8 clSyms[INFLATE_MAX_LITS_DISTS], clExtra[INFLATE_MAX_LITS_DISTS];
+	cc_uint16 clFreqs[INFLATE_MAX_CODELENS] = { 0 };
+	cc_uint32 dynamicBits, fixedBits, storedBits;
+	int numLits, numDists, numCodeLens, numSyms;
+	int i, p, dist;
+	cc_result res;
+
+	state->LitsFreqs[256] = 1; /* End of block symbol */
+	Deflate_BuildLengths(state->LitsFreqs,  286, 15, litLens);
+	Deflate_BuildLengths(state->DistsFreqs, 30,  15, distLens);
+	/* At least one distance code must be present, even if no pairs were used */
+	for (i = 0; i < 30 && !distLens[i]; i++) { }
+	if (i == 30) distLens[0] = 1;
+
+	for (numLits  = 286; numLits  > 257 && !litLens[numLits   - 1]; numLits--)  { }
+	for (numDists = 30;  numDists > 1   && !distLens[numDists - 1]; numDists--) { }
+
+	Mem_Copy(lens,           litLens,  numLits);
+	Mem_Copy(lens + numLits, distLens, numDists);
+	numSyms = Deflate_EncodeCodeLens(lens, numLits + numDists, clSyms, clExtra, clFreqs);
+	Deflate_BuildLengths(clFreqs, INFLATE_MAX_CODELENS, 7, clLens);
+	for (numCodeLens = INFLATE_MAX_CODELENS; numCodeLens > 4 && !clLens[codelens_order[numCodeLens - 1]]; numCodeLens--) { }
+
+	dynamicBits = 3 + 5 + 5 + 4 + numCodeLens * 3 + Deflate_CalcDataBits(state, litLens, distLens);
+	for (i = 0; i < numSyms; i++) dynamicBits += clLens[clSyms[i]] + codelens_extra[clSyms[i]];
+	fixedBits   = 3 + Deflate_CalcDataBits(state, fixed_lits, fixed_dists);
+	storedBits  = 3 + 7 + 32 + len * 8;
+
+	/* Ensure there's always enough space in output for the block header */
+	if (state->AvailOut < 512 && (res = Deflate_FlushOutput(state))) return res;
+	if (storedBits <= fixedBits && storedBits <= dynamicBits) {
+		return Deflate_WriteStored(state, data, len, final);
+	}
+
+	Deflate_PushBits(state, final, 1);
+	if (dynamicBits < fixedBits) {
+		Deflate_PushBits(state, 2, 2); /* block type DYNAMIC */
+		Deflate_WriteDynamicHeader(state, clSyms, clExtra, numSyms, clLens, numLits, numDists, numCodeLens);
+
+		Mem_Copy(state->LitsLens,  litLens,  INFLATE_MAX_LITS);
+		Mem_Copy(state->DistsLens, distLens, INFLATE_MAX_DISTS);
+	} else {
+		Deflate_PushBits(state, 1, 2); /* block type FIXED */
+		Deflate_FlushBits(state);
+
+		Mem_Copy(state->LitsLens,  fixed_lits,  INFLATE_MAX_LITS);
+		Mem_Copy(state->DistsLens, fixed_dists, INFLATE_MAX_DISTS);
+	}
+	Deflate_BuildCodewords(state->LitsLens,  INFLATE_MAX_LITS,  state->LitsCodewords);
+	Deflate_BuildCodewords(state->DistsLens, INFLATE_MAX_DISTS, state->DistsCodewords);
+
+	for (i = 0, p = 0; i < state->NumSymbols; i++) 
+	{
+		if (state->SymbolFlags[i >> 3] & (1 << (i & 7))) {
+			dist = (state->Symbols[p + 1] | (state->Symbols[p + 2] << 8)) + 1;
+			Deflate_LenDist(state, state->Symbols[p] + MIN_MATCH_LEN, dist);
+			p += 3;
+		} else {
+			Deflate_Lit(state, state->Symbols[p]);
+			p += 1;
+		}
+
+		/* leave room for a few bytes and literals at end */
+		if (state->AvailOut >= 20) continue;
+		if ((res = Deflate_FlushOutput(state))) return res;
+	}
+
+	Deflate_Lit(state, 256);
+	return 0;
+}
+
+/* Moves "current block" to "previous block", adjusting state if needed. */
+static void Deflate_MoveBlock(struct DeflateState* state) {
+	Mem_Copy(state->Input, state->Input + DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
+	state->InputPosition = DEFLATE_BLOCK_SIZE;
+	/* Hash chains store stream positions, so entries for data that's no longer */
+	/*  in Input automatically become invalid once the window moves past them */
+	state->WindowStart  += DEFLATE_BLOCK_SIZE;
+}
+
 /* Compresses current block of data */
-static cc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
-	cc_uint32 hash, nextHash;
-	int bestLen, maxLen, matchLen, depth;
-	int bestPos, pos, nextPos;
-	cc_uint16 oldHead;
+static cc_result Deflate_FlushBlock(struct DeflateState* state, int len, cc_bool final) {
+	const struct DeflateConfig* cfg = &deflate_configs[state->Level];
+	int bestLen, bestPos, nextPos, maxLen;
+	int pos, i, run, blockLen = len;
+	cc_uint32 hash;
 	cc_uint8* input;
 	cc_uint8* cur;
 	cc_result res;
 
-	if (!state->WroteHeader) {
-		state->WroteHeader = true;
-		Deflate_PushBits(state, 3, 3); /* final block TRUE, block type FIXED */
-	}
+	state->NumSymbols    = 0;
+	state->SymbolsLength = 0;
+	Mem_Set(state->SymbolFlags, 0, sizeof(state->SymbolFlags));
+	Mem_Set(state->LitsFreqs,   0, sizeof(state->LitsFreqs));
+	Mem_Set(state->DistsFreqs,  0, sizeof(state->DistsFreqs));
 
 	/* Based off descriptions from http://www.gzip.org/algorithm.txt and
 	https://github.com/nothings/stb/blob/master/stb_image_write.h */
 	input = state->Input;
 	cur   = input + DEFLATE_BLOCK_SIZE;
 
-	/* Compress current block of data */
+	/* Find matches in current block of data */
 	/* Use > instead of >=, because also try match at one byte after current */
 	while (len > MIN_MATCH_LEN) {
 		hash   = Deflate_Hash(cur);
+		pos    = (int)(cur - input);
 		maxLen = min(len, MAX_MATCH_LEN);
 
-		bestLen = MIN_MATCH_LEN - 1; /* Match must be at least 3 bytes */
-		bestPos = 0;
-
-		/* Find longest match starting at this byte */
-		/* Only explore up to 5 previous matches, to avoid slow performance */
-		/* (i.e prefer quickly saving maps/screenshots to completely optimal filesize) */
-		pos = state->Head[hash];
-		for (depth = 0; pos != 0 && depth < 5; depth++) {
-			matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
-			if (matchLen > bestLen) { bestLen = matchLen; bestPos = pos; }
-			pos = state->Prev[pos];
+		/* Long runs of the same byte are very common in block data, so just encode */
+		/*  them as a match with the previous byte, without searching hash chains at all */
+		if (cur > input + DEFLATE_BLOCK_SIZE && cur[-1] == cur[0]) {
+			run = Deflate_MatchLen(cur - 1, cur, maxLen);
+
+			if (run >= DEFLATE_MIN_RUN_LEN) {
+				Deflate_AddPair(state, run, 1);
+				/* Only the end of the run needs to be in the hash chains */
+				for (i = run - MIN_MATCH_LEN; i < run && len - i >= MIN_MATCH_LEN; i++)
+				{
+					Deflate_Insert(state, Deflate_Hash(cur + i), pos + i);
+				}
+				len -= run; cur += run;
+				continue;
+			}
 		}
 
-		/* Insert this entry into the hash chain */
-		pos = (int)(cur - input);
-		oldHead = state->Head[hash];
-		state->Head[hash] = pos;
-		state->Prev[pos]  = oldHead;
+		/* Find longest match starting at this byte (must be at least 3 bytes) */
+		bestLen = Deflate_FindMatch(state, state->Tables->Head[hash], cur, maxLen, MIN_MATCH_LEN - 1, &bestPos);
+		Deflate_Insert(state, hash, pos);
 
 		/* Lazy evaluation: Find longest match starting at next byte */
 		/* If that's longer than the longest match at current byte, throwaway this match */
-		if (bestPos) {
-			nextHash = Deflate_Hash(cur + 1);
-			nextPos  = state->Head[nextHash];
-			maxLen   = min(len - 1, MAX_MATCH_LEN);
-
-			for (depth = 0; nextPos != 0 && depth < 5; depth++) {
-				matchLen = Deflate_MatchLen(&input[nextPos], cur + 1, maxLen);
-				if (matchLen > bestLen) { bestPos = 0; break; }
-				nextPos = state->Prev[nextPos];
-			}
+		maxLen = min(len - 1, MAX_MATCH_LEN);
+		if (bestPos && bestLen < cfg->lazyLen && bestLen < maxLen) {
+			hash = Deflate_Hash(cur + 1);
+			Deflate_FindMatch(state, state->Tables->Head[hash], cur + 1, maxLen, bestLen, &nextPos);
+			if (nextPos) bestPos = 0;
 		}
 
 		if (bestPos) {
-			Deflate_LenDist(state, bestLen, pos - bestPos);
+			Deflate_AddPair(state, bestLen, pos - bestPos);
+
+			/* Only need to check if 3 bytes are left, as the hash uses 3 bytes */
+			for (i = 1; cfg->insertAll && i < bestLen && len - i >= MIN_MATCH_LEN; i++) 
+			{
+				hash = Deflate_Hash(cur + i);
+				Deflate_Insert(state, hash, pos + i);
+			}
 			len -= bestLen; cur += bestLen;
 		} else {
-			Deflate_Lit(state, *cur);
+			Deflate_AddLit(state, *cur);
 			len--; cur++;
 		}
-
-		/* leave room for a few bytes and literals at end */
-		if (state->AvailOut >= 20) continue;
-		res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-		state->NextOut  = state->Output;
-		state->AvailOut = DEFLATE_OUT_SIZE;
-		if (res) return res;
 	}
 
 	/* literals for last few bytes */
 	while (len > 0) {
-		Deflate_Lit(state, *cur);
+		Deflate_AddLit(state, *cur);
 		len--; cur++;
 	}
 
-	res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-	state->NextOut  = state->Output;
-	state->AvailOut = DEFLATE_OUT_SIZE;
-
+	res = Deflate_WriteBlock(state, input + DEFLATE_BLOCK_SIZE, blockLen, final);
 	Deflate_MoveBlock(state);
 	return res;
 }
 
+/* Pads out the last partial byte, then writes all remaining output */
+static cc_result Deflate_Finish(struct DeflateState* state) {
+	/* In case last byte still has a few extra bits */
+	if (state->NumBits) {
+		while (state->NumBits < 8) { Deflate_PushBits(state, 0, 1); }
+		Deflate_FlushBits(state);
+	}
+	return Deflate_FlushOutput(state);
+}
+
+/* Minimum number of bytes that must be written before switching to parallel compression */
+#define DEFLATE_PARALLEL_THRESHOLD (1024 * 1024)
+static cc_result DeflateJobs_Start(struct DeflateState* state);
+static cc_result DeflateJobs_Write(struct DeflateState* state, const cc_uint8* data, cc_uint32 count);
+static cc_result DeflateJobs_Finish(struct DeflateState* state);
+
 /* Adds data to buffered output data, flushing if needed */
 static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 total, cc_uint32* modified) {
 	struct DeflateState* state;
@@ -962,6 +1392,11 @@ static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data
 
 	while (total > 0) {
 		cc_uint8* dst = &state->Input[state->InputPosition];
+		if (state->Parallel) {
+			*modified += total;
+			return DeflateJobs_Write(state, data, total);
+		}
+
 		cc_uint32 len = total;
 		if (state->InputPosition + len >= DEFLATE_BUFFER_SIZE) {
 			len = DEFLATE_BUFFER_SIZE - state->InputPosition;
@@ -974,53 +1409,32 @@ static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data
 		data += len;
 
 		if (state->InputPosition == DEFLATE_BUFFER_SIZE) {
-			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE);
-			if (res) return res;
+			res = Deflate_AllocTables(state);
+			if (!res) res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE, false);
+			if (res) { Deflate_FreeTables(state); return res; }
+			state->TotalInput += DEFLATE_BLOCK_SIZE;
+
+			if (!state->AllowParallel || state->TotalInput < DEFLATE_PARALLEL_THRESHOLD) continue;
+			if ((res = DeflateJobs_Start(state))) return res;
 		}
 	}
 	return 0;
 }
 
-/* Flushes any buffered data, then writes terminating symbol */
+/* Flushes any buffered data as the final block */
 static cc_result Deflate_StreamClose(struct Stream* stream) {
 	struct DeflateState* state;
 	cc_result res;
 
 	state = (struct DeflateState*)stream->meta.inflate;
-	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE);
-	if (res) return res;
+	if (state->Parallel) return DeflateJobs_Finish(state);
 
-	/* Write huffman encoded "literal 256" to terminate symbols */
-	Deflate_PushLit(state, 256);
-	Deflate_FlushBits(state);
-
-	/* In case last byte still has a few extra bits */
-	if (state->NumBits) {
-		while (state->NumBits < 8) { Deflate_PushBits(state, 0, 1); }
-		Deflate_FlushBits(state);
-	}
+	res = Deflate_AllocTables(state);
+	if (!res) res = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE, true);
+	Deflate_FreeTables(state);
 
-	return Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-}
-
-/* Constructs a huffman encoding table (for values to codewords) */
-static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens) {
-	int i, j, offset, codeword;
-	struct HuffmanTable table;
-
-	/* NOTE: Can ignore since lens table is not user controlled */
-	(void)Huffman_Build(&table, lens, count);
-	for (i = 0; i < INFLATE_MAX_BITS; i++) {
-		if (!table.endCodewords[i]) continue;
-		count = table.endCodewords[i] - table.firstCodewords[i];
-
-		for (j = 0; j < count; j++) {
-			offset   = table.values[table.firstOffsets[i] + j];
-			codeword = table.firstCodewords[i] + j;
-			bitlens[offset]   = i;
-			codewords[offset] = Huffman_ReverseBits(codeword, i);
-		}
-	}
+	if (res) return res;
+	return Deflate_Finish(state);
 }
 
 void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
@@ -1037,13 +1451,318 @@ void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struc
 	state->NextOut  = state->Output;
 	state->AvailOut = DEFLATE_OUT_SIZE;
 	state->Dest     = underlying;
-	state->WroteHeader = false;
+	state->Level    = DEFLATE_LEVEL_DEFAULT;
+
+	state->AllowParallel = true;
+	state->Parallel      = false;
+	state->TotalInput    = 0;
+
+	state->WindowStart = 0;
+	state->Tables      = NULL;
+}
+
+/*########################################################################################################################*
+*---------------------------------------------------Deflate (parallel)----------------------------------------------------*
+*#########################################################################################################################*/
+#if defined CC_BUILD_COOPTHREADED || defined CC_BUILD_LOWMEM
+/* No point compressing on multiple threads on these platforms */
+static cc_result DeflateJobs_Start(struct DeflateState* state) {
+	state->AllowParallel = false;
+	return 0;
+}
+static cc_result DeflateJobs_Write(struct DeflateState* state, const cc_uint8* data, cc_uint32 count) { return 0; }
+static cc_result DeflateJobs_Finish(struct DeflateState* state) { return 0; }
+#else
+/* Input data is split up into independent jobs, which are compressed by worker threads (like pigz). */
+/* Each job is primed with the last block of the previous job's data, so that it can still reference */
+/*  that data in matches. Non final jobs end in an empty stored block, which pads the compressed data */
+/*  out to a byte boundary, so the outputs can then just be written one after another in order. */
+#define DEFLATE_MAX_WORKERS 8
+#define DEFLATE_JOB_SIZE      (DEFLATE_BLOCK_SIZE * 16)
+/* Worst case is every block being stored, which adds up to 7 bytes per block */
+#define DEFLATE_JOB_OUT_SIZE  (DEFLATE_JOB_SIZE + 1024)
+
+enum DEFLATE_JOB_STATUS { DEFLATE_JOB_FREE, DEFLATE_JOB_QUEUED, DEFLATE_JOB_DONE };
+struct DeflateJob {
+	cc_uint8 Input[DEFLATE_BLOCK_SIZE + DEFLATE_JOB_SIZE]; /* Dictionary block, then data to compress */
+	cc_uint8 Output[DEFLATE_JOB_OUT_SIZE];
+	cc_uint32 InputLength, OutputLength;
+	cc_uint8 Level, Status;
+	cc_bool Final;
+	cc_result Result;
+};
+
+static struct DeflateJobsData {
+	struct DeflateJob* Jobs;      /* Ring buffer of jobs (2 per worker) */
+	struct DeflateState* States;  /* Compressor state for each worker */
+	struct DeflateTables* Tables; /* Hash chains for each worker */
+	void* Threads[DEFLATE_MAX_WORKERS];
+	void* Waits[DEFLATE_MAX_WORKERS]; /* Signalled when a job is queued for a worker */
+	void* JobDone; /* Signalled when a worker finishes a job */
+	void* Mutex;   /* Protects Status of jobs, Stopping and NumStarted */
+	int NumWorkers, NumJobs;
+	int Head, Tail, NumPending, NumStarted;
+	cc_bool InUse, Stopping;
+} deflate_jobs;
+
+static cc_result DeflateJob_OutputWrite(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	if (count > s->meta.mem.left) return ERR_END_OF_STREAM;
+	Mem_Copy(s->meta.mem.cur, data, count);
+
+	s->meta.mem.cur  += count;
+	s->meta.mem.left -= count;
+	*modified = count;
+	return 0;
+}
+
+/* Compresses all the data in the given job into its output buffer */
+static cc_result DeflateJob_Compress(struct DeflateJob* job, struct DeflateState* state, struct DeflateTables* tables) {
+	struct Stream stream, output;
+	cc_uint8* data = job->Input + DEFLATE_BLOCK_SIZE;
+	cc_uint32 len, left = job->InputLength;
+	cc_bool last;
+	cc_result res;
+	int i;
+
+	Stream_Init(&output);
+	output.Write = DeflateJob_OutputWrite;
+	output.meta.mem.cur  = job->Output;
+	output.meta.mem.left = DEFLATE_JOB_OUT_SIZE;
+
+	Deflate_MakeStream(&stream, state, &output);
+	state->Level  = job->Level;
+	state->Tables = tables;
+	Mem_Set(tables, 0, sizeof(struct DeflateTables));
+
+	/* Prime hash chains with the dictionary block */
+	Mem_Copy(state->Input, job->Input, DEFLATE_BLOCK_SIZE);
+	for (i = 1; i <= DEFLATE_BLOCK_SIZE - MIN_MATCH_LEN; i++)
+	{
+		Deflate_Insert(state, Deflate_Hash(state->Input + i), i);
+	}
+
+	do {
+		len  = min(left, DEFLATE_BLOCK_SIZE);
+		last = len == left;
+		Mem_Copy(state->Input + DEFLATE_BLOCK_SIZE, data, len);
+
+		if ((res = Deflate_FlushBlock(state, len, last && job->Final))) return res;
+		data += len; left -= len;
+	} while (!last);
+
+	/* Empty stored block pads output to next byte boundary */
+	if (!job->Final && (res = Deflate_WriteStored(state, NULL, 0, false))) return res;
+	if ((res = Deflate_Finish(state))) return res;
+
+	job->OutputLength = DEFLATE_JOB_OUT_SIZE - output.meta.mem.left;
+	return 0;
+}
+
+static int DeflateJob_GetStatus(struct DeflateJob* job) {
+	int status;
+	Mutex_Lock(deflate_jobs.Mutex);
+	status = job->Status;
+	Mutex_Unlock(deflate_jobs.Mutex);
+	return status;
+}
+
+static void DeflateJob_SetStatus(struct DeflateJob* job, int status) {
+	Mutex_Lock(deflate_jobs.Mutex);
+	job->Status = status;
+	Mutex_Unlock(deflate_jobs.Mutex);
+}
+
+/* Worker N processes jobs N, N + NumWorkers, etc in the ring buffer */
+static void DeflateWorker_Run(void) {
+	struct DeflateJob* job;
+	cc_bool stopping;
+	int id, slot;
+
+	Mutex_Lock(deflate_jobs.Mutex);
+	id = deflate_jobs.NumStarted++;
+	Mutex_Unlock(deflate_jobs.Mutex);
+
+	for (slot = id; ; slot = (slot + deflate_jobs.NumWorkers) % deflate_jobs.NumJobs)
+	{
+		job = &deflate_jobs.Jobs[slot];
+		for (;;) {
+			Mutex_Lock(deflate_jobs.Mutex);
+			stopping = deflate_jobs.Stopping && job->Status != DEFLATE_JOB_QUEUED;
+			Mutex_Unlock(deflate_jobs.Mutex);
+
+			if (stopping) return;
+			if (DeflateJob_GetStatus(job) == DEFLATE_JOB_QUEUED) break;
+			Waitable_Wait(deflate_jobs.Waits[id]);
+		}
+
+		job->Result = DeflateJob_Compress(job, &deflate_jobs.States[id], &deflate_jobs.Tables[id]);
+		DeflateJob_SetStatus(job, DEFLATE_JOB_DONE);
+		Waitable_Signal(deflate_jobs.JobDone);
+	}
+}
+
+static void DeflateJobs_Stop(struct DeflateState* state) {
+	int i;
+	Mutex_Lock(deflate_jobs.Mutex);
+	deflate_jobs.Stopping = true;
+	Mutex_Unlock(deflate_jobs.Mutex);
+
+	for (i = 0; i < deflate_jobs.NumWorkers; i++) { Waitable_Signal(deflate_jobs.Waits[i]); }
+	for (i = 0; i < deflate_jobs.NumWorkers; i++) 
+	{
+		Thread_Join(deflate_jobs.Threads[i]);
+		Waitable_Free(deflate_jobs.Waits[i]);
+	}
+
+	Waitable_Free(deflate_jobs.JobDone);
+	Mutex_Free(deflate_jobs.Mutex);
+	Mem_Free(deflate_jobs.Jobs);
+	Mem_Free(deflate_jobs.States);
+	Mem_Free(deflate_jobs.Tables);
+
+	deflate_jobs.InUse   = false;
+	state->Parallel      = false;
+	state->AllowParallel = false;
+}
+
+/* Queues the job currently being filled with data for compression */
+static void DeflateJobs_Submit(struct DeflateState* state, cc_bool final) {
+	struct DeflateJob* job = &deflate_jobs.Jobs[deflate_jobs.Head];
+	job->Level = state->Level;
+	job->Final = final;
+
+	DeflateJob_SetStatus(job, DEFLATE_JOB_QUEUED);
+	Waitable_Signal(deflate_jobs.Waits[deflate_jobs.Head % deflate_jobs.NumWorkers]);
+	deflate_jobs.Head = (deflate_jobs.Head + 1) % deflate_jobs.NumJobs;
+	deflate_jobs.NumPending++;
+}
+
+/* Waits for the oldest job to finish compressing, then writes out its compressed data */
+static cc_result DeflateJobs_WriteOldest(struct DeflateState* state) {
+	struct DeflateJob* job = &deflate_jobs.Jobs[deflate_jobs.Tail];
+	while (DeflateJob_GetStatus(job) != DEFLATE_JOB_DONE) 
+	{
+		Waitable_Wait(deflate_jobs.JobDone);
+	}
 
-	Mem_Set(state->Head, 0, sizeof(state->Head));
-	Mem_Set(state->Prev, 0, sizeof(state->Prev));
-	Deflate_BuildTable(fixed_lits, INFLATE_MAX_LITS, state->LitsCodewords, state->LitsLens);
+	deflate_jobs.Tail = (deflate_jobs.Tail + 1) % deflate_jobs.NumJobs;
+	deflate_jobs.NumPending--;
+	DeflateJob_SetStatus(job, DEFLATE_JOB_FREE);
+
+	if (job->Result) return job->Result;
+	return Stream_Write(state->Dest, job->Output, job->OutputLength);
 }
 
+static cc_result DeflateJobs_Start(struct DeflateState* state) {
+	struct DeflateJob* job;
+	int i, numWorkers;
+	cc_result res;
+	/* Only one stream at a time can use the worker threads */
+	if (deflate_jobs.InUse) { state->AllowParallel = false; return 0; }
+
+	numWorkers = min(Thread_CpuCount(), DEFLATE_MAX_WORKERS);
+	/* No point compressing on a worker thread when there's only one CPU core */
+	if (numWorkers < 2) { state->AllowParallel = false; return 0; }
+	deflate_jobs.NumWorkers = numWorkers;
+	deflate_jobs.NumJobs    = numWorkers * 2;
+
+	deflate_jobs.Jobs   = (struct DeflateJob*)Mem_TryAlloc(deflate_jobs.NumJobs, sizeof(struct DeflateJob));
+	deflate_jobs.States = (struct DeflateState*)Mem_TryAlloc(numWorkers, sizeof(struct DeflateState));
+	deflate_jobs.Tables = (struct DeflateTables*)Mem_TryAlloc(numWorkers, sizeof(struct DeflateTables));
+
+	/* Not having enough memory isn't a problem, since can just keep compressing on this thread */
+	if (!deflate_jobs.Jobs || !deflate_jobs.States || !deflate_jobs.Tables) {
+		Mem_Free(deflate_jobs.Jobs);
+		Mem_Free(deflate_jobs.States);
+		Mem_Free(deflate_jobs.Tables);
+		state->AllowParallel = false;
+		return 0;
+	}
+	/* Hash chains of this stream aren't needed anymore, since workers compress all further data */
+	Deflate_FreeTables(state);
+
+	/* Pad output to a byte boundary, so job outputs can just be appended afterwards */
+	res = Deflate_WriteStored(state, NULL, 0, false);
+	if (!res) res = Deflate_Finish(state);
+
+	if (res) {
+		Mem_Free(deflate_jobs.Jobs);
+		Mem_Free(deflate_jobs.States);
+		Mem_Free(deflate_jobs.Tables);
+		return res;
+	}
+
+	for (i = 0; i < deflate_jobs.NumJobs; i++) 
+	{
+		deflate_jobs.Jobs[i].Status = DEFLATE_JOB_FREE;
+	}
+	/* Last block written is the dictionary block for the first job */
+	job = &deflate_jobs.Jobs[0];
+	Mem_Copy(job->Input, state->Input, DEFLATE_BLOCK_SIZE);
+	job->InputLength = 0;
+
+	deflate_jobs.Head       = 0;
+	deflate_jobs.Tail       = 0;
+	deflate_jobs.NumPending = 0;
+	deflate_jobs.NumStarted = 0;
+	deflate_jobs.Stopping   = false;
+	deflate_jobs.InUse      = true;
+	state->Parallel         = true;
+
+	deflate_jobs.Mutex   = Mutex_Create("Deflate jobs");
+	deflate_jobs.JobDone = Waitable_Create("Deflate job done");
+	for (i = 0; i < numWorkers; i++)
+	{
+		deflate_jobs.Waits[i] = Waitable_Create("Deflate job queued");
+		Thread_Run(&deflate_jobs.Threads[i], DeflateWorker_Run, 64 * 1024, "Deflate worker");
+	}
+	return 0;
+}
+
+static cc_result DeflateJobs_Write(struct DeflateState* state, const cc_uint8* data, cc_uint32 count) {
+	struct DeflateJob* job;
+	struct DeflateJob* next;
+	cc_uint32 len;
+	cc_result res;
+
+	while (count > 0) {
+		job = &deflate_jobs.Jobs[deflate_jobs.Head];
+		len = min(count, DEFLATE_JOB_SIZE - job->InputLength);
+		Mem_Copy(job->Input + DEFLATE_BLOCK_SIZE + job->InputLength, data, len);
+
+		job->InputLength  += len;
+		state->TotalInput += len;
+		data += len; count -= len;
+		if (job->InputLength < DEFLATE_JOB_SIZE) continue;
+
+		DeflateJobs_Submit(state, false);
+		/* All jobs in use, so need to wait for the oldest one to finish */
+		if (deflate_jobs.NumPending == deflate_jobs.NumJobs) {
+			res = DeflateJobs_WriteOldest(state);
+			if (res) { DeflateJobs_Stop(state); return res; }
+		}
+
+		/* Last block of this job is the dictionary block for the next job */
+		next = &deflate_jobs.Jobs[deflate_jobs.Head];
+		Mem_Copy(next->Input, job->Input + DEFLATE_JOB_SIZE, DEFLATE_BLOCK_SIZE);
+		next->InputLength = 0;
+	}
+	return 0;
+}
+
+static cc_result DeflateJobs_Finish(struct DeflateState* state) {
+	cc_result res = 0;
+	DeflateJobs_Submit(state, true);
+
+	while (deflate_jobs.NumPending && !res) 
+	{
+		res = DeflateJobs_WriteOldest(state);
+	}
+	DeflateJobs_Stop(state);
+	return res;
+}
+#endif
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------GZip (compress)-----------------------------------------------------*
@@ -1161,6 +1880,34 @@ struct ZipState {
 	cc_uint32 centralDirBeg;
 };
 
+enum ZipSig {
+	ZIP_SIG_ENDOFCENTRALDIR = 0x06054b50,
+	ZIP_SIG_CENTRALDIR      = 0x02014b50,
+	ZIP_SIG_LOCALFILEHEADER = 0x04034b50
+};
+
+/* Seeks to the start of the given entry's data, returning its compression method */
+static cc_result Zip_SeekEntryData(struct Stream* stream, struct ZipEntry* entry, int* method) {
+	cc_uint8 header[26];
+	cc_uint32 sig = 0;
+	int pathLen, extraLen;
+	cc_result res;
+
+	res = stream->Seek(stream, entry->LocalHeaderOffset);
+	if (res) return ZIP_ERR_SEEK_LOCAL_DIR;
+
+	if ((res = Stream_ReadU32_LE(stream, &sig))) return res;
+	if (sig != ZIP_SIG_LOCALFILEHEADER) return ZIP_ERR_INVALID_LOCAL_DIR;
+
+	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
+	pathLen  = Stream_GetU16_LE(&header[22]);
+	extraLen = Stream_GetU16_LE(&header[24]);
+	*method  = Stream_GetU16_LE(&header[4]);
+
+	/* local file may have extra data before actual data (e.g. ZIP64) */
+	return stream->Skip(stream, pathLen + extraLen);
+}
+
 static cc_result Zip_ReadLocalFileHeader(struct ZipState* state, struct ZipEntry* entry) {
 	struct Stream* stream = state->source;
 	cc_uint8 header[26];
@@ -1221,12 +1968,10 @@ static cc_result Zip_ReadLocalFileHeader(struct ZipState* state, struct ZipEntry
 	return res;
 }
 
-static cc_result Zip_ReadCentralDirectory(struct ZipState* state) {
-	struct Stream* stream = state->source;
-	struct ZipEntry* entry;
+/* Reads the path and details of an entry from the central directory */
+/* NOTE: path must have a capacity of at least ZIP_MAXNAMELEN */
+static cc_result Zip_ReadCentralDirectory(struct Stream* stream, cc_string* path, struct ZipEntry* entry) {
 	cc_uint8 header[42];
-
-	cc_string path; char pathBuffer[ZIP_MAXNAMELEN];
 	int pathLen, extraLen, commentLen;
 	cc_result res;
 
@@ -1235,18 +1980,15 @@ static cc_result Zip_ReadCentralDirectory(struct ZipState* state) {
 	if (pathLen > ZIP_MAXNAMELEN) return ZIP_ERR_FILENAME_LEN;
 
 	/* NOTE: ZIP spec says path uses code page 437 for encoding */
-	path = String_Init(pathBuffer, pathLen, pathLen);
-	if ((res = Stream_Read(stream, (cc_uint8*)pathBuffer, pathLen))) return res;
+	path->length = pathLen;
+	if ((res = Stream_Read(stream, (cc_uint8*)path->buffer, pathLen))) return res;
 
 	/* skip data following central directory entry header */
 	extraLen   = Stream_GetU16_LE(&header[26]);
 	commentLen = Stream_GetU16_LE(&header[28]);
 	if ((res = stream->Skip(stream, extraLen + commentLen))) return res;
 
-	if (!state->SelectEntry(&path)) return 0;
-	if (state->usedEntries >= state->maxEntries) return ZIP_ERR_TOO_MANY_ENTRIES;
-	entry = &state->entries[state->usedEntries++];
-
+	entry->CRC32             = Stream_GetU32_LE(&header[12]);
 	entry->CompressedSize    = Stream_GetU32_LE(&header[16]);
 	entry->UncompressedSize  = Stream_GetU32_LE(&header[20]);
 	entry->LocalHeaderOffset = Stream_GetU32_LE(&header[38]);
@@ -1265,15 +2007,9 @@ static cc_result Zip_ReadEndOfCentralDirectory(struct ZipState* state) {
 	return 0;
 }
 
-enum ZipSig {
-	ZIP_SIG_ENDOFCENTRALDIR = 0x06054b50,
-	ZIP_SIG_CENTRALDIR      = 0x02014b50,
-	ZIP_SIG_LOCALFILEHEADER = 0x04034b50
-};
-
-cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_ProcessEntry processor, 
-						struct ZipEntry* entries, int maxEntries) {
-	struct ZipState state;
+/* Finds and reads the end of central directory record, then seeks to the first central directory entry */
+static cc_result Zip_SeekCentralDirectory(struct ZipState* state) {
+	struct Stream* source = state->source;
 	cc_uint32 stream_len;
 	cc_uint32 sig = 0;
 	int i, count;
@@ -1291,32 +2027,57 @@ cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_Proce
 		if (sig == ZIP_SIG_ENDOFCENTRALDIR) break;
 	}
 
+	if (sig != ZIP_SIG_ENDOFCENTRALDIR) return ZIP_ERR_NO_END_OF_CENTRAL_DIR;
+	res = Zip_ReadEndOfCentralDirectory(state);
+	if (res) return res;
+
+	res = source->Seek(source, state->centralDirBeg);
+	if (res) return ZIP_ERR_SEEK_CENTRAL_DIR;
+	return 0;
+}
+
+/* Reads the signature of the next central directory entry, returning false once there are no more */
+static cc_result Zip_NextCentralDirectory(struct Stream* source, cc_bool* hasEntry) {
+	cc_uint32 sig = 0;
+	cc_result res;
+	if ((res = Stream_ReadU32_LE(source, &sig))) return res;
+
+	*hasEntry = sig == ZIP_SIG_CENTRALDIR;
+	if (sig == ZIP_SIG_CENTRALDIR || sig == ZIP_SIG_ENDOFCENTRALDIR) return 0;
+	return ZIP_ERR_INVALID_CENTRAL_DIR;
+}
+
+cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_ProcessEntry processor, 
+						struct ZipEntry* entries, int maxEntries) {
+	struct ZipState state;
+	struct ZipEntry dirEntry;
+	cc_string path; char pathBuffer[ZIP_MAXNAMELEN];
+	cc_uint32 sig = 0;
+	cc_bool hasEntry;
+	int i;
+	cc_result res;
+
 	state.source       = source;
 	state.SelectEntry  = selector;
 	state.ProcessEntry = processor;
 	state.entries      = entries;
 	state.maxEntries   = maxEntries;
 
-	if (sig != ZIP_SIG_ENDOFCENTRALDIR) return ZIP_ERR_NO_END_OF_CENTRAL_DIR;
-	res = Zip_ReadEndOfCentralDirectory(&state);
-	if (res) return res;
-
-	res = source->Seek(source, state.centralDirBeg);
-	if (res) return ZIP_ERR_SEEK_CENTRAL_DIR;
+	if ((res = Zip_SeekCentralDirectory(&state))) return res;
 	state.usedEntries = 0;
+	String_InitArray(path, pathBuffer);
 
 	/* Read all the central directory entries */
 	for (i = 0; i < state.totalEntries; i++) {
-		if ((res = Stream_ReadU32_LE(source, &sig))) return res;
+		if ((res = Zip_NextCentralDirectory(source, &hasEntry))) return res;
+		if (!hasEntry) break;
 
-		if (sig == ZIP_SIG_CENTRALDIR) {
-			res = Zip_ReadCentralDirectory(&state);
-			if (res) return res;
-		} else if (sig == ZIP_SIG_ENDOFCENTRALDIR) {
-			break;
-		} else {
-			return ZIP_ERR_INVALID_CENTRAL_DIR;
-		}
+		res = Zip_ReadCentralDirectory(source, &path, &dirEntry);
+		if (res) return res;
+
+		if (!state.SelectEntry(&path)) continue;
+		if (state.usedEntries >= state.maxEntries) return ZIP_ERR_TOO_MANY_ENTRIES;
+		state.entries[state.usedEntries++] = dirEntry;
 	}
 
 	/* Now read the local file header entries */
@@ -1333,3 +2094,369 @@ cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_Proce
 	}
 	return 0;
 }
+
+
+/*########################################################################################################################*
+*---------------------------------------------------------ZipIndex--------------------------------------------------------*
+*#########################################################################################################################*/
+/* Paths are stored with 10 length bits, leaving 22 bits for offsets (i.e. 4 MB of paths) */
+#define ZIP_INDEX_LEN_BITS  10
+#define ZIP_INDEX_MAX_PATHS (1UL << (32 - ZIP_INDEX_LEN_BITS))
+
+void ZipIndex_Free(struct ZipIndex* index) {
+	Mem_Free(index->entries);
+	StringsBuffer_Clear(&index->paths);
+	index->entries = NULL;
+	index->count   = 0;
+}
+
+cc_result ZipIndex_Read(struct ZipIndex* index, struct Stream* source) {
+	struct ZipState state;
+	cc_string path; char pathBuffer[ZIP_MAXNAMELEN];
+	cc_bool hasEntry;
+	int i;
+	cc_result res;
+
+	index->source  = source;
+	index->entries = NULL;
+	index->count   = 0;
+	StringsBuffer_Init(&index->paths);
+	/* Default length bits only allows paths up to 511 characters */
+	StringsBuffer_SetLengthBits(&index->paths, ZIP_INDEX_LEN_BITS);
+
+	state.source = source;
+	if ((res = Zip_SeekCentralDirectory(&state))) return res;
+	if (!state.totalEntries) return 0;
+
+	index->entries = (struct ZipEntry*)Mem_TryAlloc(state.totalEntries, sizeof(struct ZipEntry));
+	if (!index->entries) return ERR_OUT_OF_MEMORY;
+	String_InitArray(path, pathBuffer);
+
+	for (i = 0; i < state.totalEntries; i++) {
+		if ((res = Zip_NextCentralDirectory(source, &hasEntry))) return res;
+		if (!hasEntry) break;
+
+		res = Zip_ReadCentralDirectory(source, &path, &index->entries[i]);
+		if (res) return res;
+
+		/* Offsets of paths in the StringsBuffer would overflow past this */
+		if (index->paths.totalLength + path.length >= ZIP_INDEX_MAX_PATHS) return ZIP_ERR_PATHS_LENGTH;
+		StringsBuffer_Add(&index->paths, &path);
+		index->count++;
+	}
+	return 0;
+}
+
+int ZipIndex_Find(struct ZipIndex* index, const cc_string* path) {
+	cc_string entryPath;
+	int i;
+
+	for (i = 0; i < index->count; i++) 
+	{
+		entryPath = StringsBuffer_UNSAFE_Get(&index->paths, i);
+		if (String_CaselessEquals(&entryPath, path)) return i;
+	}
+	return -1;
+}
+
+static cc_result ZipIndex_CheckCRC32(struct ZipEntry* entry, const cc_uint8* data) {
+	return Utils_CRC32(data, entry->UncompressedSize) == entry->CRC32 ? 0 : ZIP_ERR_CRC32;
+}
+
+cc_result ZipIndex_ReadEntry(struct ZipIndex* index, int i, cc_uint8** data) {
+	struct ZipEntry* entry = &index->entries[i];
+	struct Stream* source  = index->source;
+	struct Stream portion, compStream;
+	struct InflateState* inflate;
+	cc_uint8* dst;
+	int method;
+	cc_result res;
+
+	*data = NULL;
+	if ((res = Zip_SeekEntryData(source, entry, &method))) return res;
+	if (method != 0 && method != 8) return ERR_NOT_SUPPORTED;
+
+	/* Add 1 so a buffer is still allocated for empty entries */
+	dst = (cc_uint8*)Mem_TryAlloc(entry->UncompressedSize + 1, 1);
+	if (!dst) return ERR_OUT_OF_MEMORY;
+
+	if (method == 0) {
+		res = Stream_Read(source, dst, entry->UncompressedSize);
+	} else {
+		inflate = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+		res     = ERR_OUT_OF_MEMORY;
+
+		if (inflate) {
+			Stream_ReadonlyPortion(&portion, source, entry->CompressedSize);
+			Inflate_MakeStream2(&compStream, inflate, &portion);
+			res = Stream_Read(&compStream, dst, entry->UncompressedSize);
+			Mem_Free(inflate);
+		}
+	}
+
+	if (!res) res = ZipIndex_CheckCRC32(entry, dst);
+	if (res) { Mem_Free(dst); return res; }
+	*data = dst;
+	return 0;
+}
+
+/* Processes the i'th entry directly from the archive, without decompressing it into memory first */
+static cc_result ZipIndex_StreamEntry(struct ZipIndex* index, int i, Zip_ProcessEntry processor) {
+	struct ZipEntry* entry = &index->entries[i];
+	struct Stream* source  = index->source;
+	struct Stream portion, compStream, crcStream;
+	struct InflateState* inflate;
+	cc_string path;
+	int method;
+	cc_result res;
+
+	if ((res = Zip_SeekEntryData(source, entry, &method))) return res;
+	path = StringsBuffer_UNSAFE_Get(&index->paths, i);
+
+	if (method == 0) {
+		Stream_ReadonlyPortion(&portion, source, entry->UncompressedSize);
+		Stream_ReadonlyCrc32(&crcStream, &portion);
+		res = processor(&path, &crcStream, entry);
+	} else if (method == 8) {
+		inflate = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+		if (!inflate) return ERR_OUT_OF_MEMORY;
+
+		Stream_ReadonlyPortion(&portion, source, entry->CompressedSize);
+		Inflate_MakeStream2(&compStream, inflate, &portion);
+		Stream_ReadonlyCrc32(&crcStream, &compStream);
+		res = processor(&path, &crcStream, entry);
+		Mem_Free(inflate);
+	} else {
+		Platform_Log1("Unsupported.zip entry compression method: %i", &method);
+		return 0;
+	}
+
+	/* CRC32 can only be checked when the processor has read all of the data */
+	if (res || crcStream.meta.crc32.length != entry->UncompressedSize) return res;
+	return (crcStream.meta.crc32.crc32 ^ 0xFFFFFFFFUL) == entry->CRC32 ? 0 : ZIP_ERR_CRC32;
+}
+
+#ifdef CC_BUILD_LOWMEM
+/* Decompressing whole entries into memory would use too much memory on these platforms, */
+/*  so just process each entry directly from the archive one after another instead */
+cc_result ZipIndex_ExtractAll(struct ZipIndex* index, Zip_SelectEntry selector, Zip_ProcessEntry processor) {
+	cc_string path;
+	cc_result res;
+	int i;
+
+	for (i = 0; i < index->count; i++) 
+	{
+		path = StringsBuffer_UNSAFE_Get(&index->paths, i);
+		if (!selector(&path)) continue;
+		if ((res = ZipIndex_StreamEntry(index, i, processor))) return res;
+	}
+	return 0;
+}
+#else
+/* Entries are extracted in batches, each of which is decompressed into memory at once */
+/* (raw data of each entry in the batch is read first, as reading from source isn't thread safe) */
+#define ZIP_BATCH_MAX_ENTRIES 64
+#define ZIP_BATCH_MAX_SIZE    (8 * 1024 * 1024)
+/* Sizes in the central directory can't be trusted, so larger entries are streamed instead */
+#define ZIP_ENTRY_MAX_SIZE    (8 * 1024 * 1024)
+#define ZIP_WORKERS_COUNT     4
+/* Not worth starting worker threads for small amounts of compressed data */
+#define ZIP_PARALLEL_MIN_SIZE (64 * 1024)
+
+struct ZipJob {
+	cc_uint8* raw;  /* Data of the entry as stored in the archive */
+	cc_uint8* data; /* Decompressed data of the entry */
+	int index, method;
+	cc_result result;
+};
+
+static struct ZipJobsData {
+	struct ZipIndex* index;
+	struct ZipJob* jobs;
+	int count, next;
+	void* mutex;
+	cc_bool inUse;
+} zip_jobs;
+
+/* Decompresses raw DEFLATE compressed data into the given buffer */
+static cc_result ZipIndex_Inflate(cc_uint8* src, cc_uint32 srcLen, cc_uint8* dst, cc_uint32 dstLen) {
+	struct Stream mem, compStream;
+	struct InflateState* inflate;
+	cc_result res;
+
+	inflate = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+	if (!inflate) return ERR_OUT_OF_MEMORY;
+
+	Stream_ReadonlyMemory(&mem, src, srcLen);
+	Inflate_MakeStream2(&compStream, inflate, &mem);
+	res = Stream_Read(&compStream, dst, dstLen);
+
+	Mem_Free(inflate);
+	return res;
+}
+
+static void ZipJob_Decompress(struct ZipJob* job) {
+	struct ZipEntry* entry = &zip_jobs.index->entries[job->index];
+
+	if (job->method == 0) {
+		job->data = job->raw;
+	} else {
+		job->data = (cc_uint8*)Mem_TryAlloc(entry->UncompressedSize + 1, 1);
+		if (!job->data) { job->result = ERR_OUT_OF_MEMORY; return; }
+
+		job->result = ZipIndex_Inflate(job->raw, entry->CompressedSize,
+										job->data, entry->UncompressedSize);
+		if (job->result) return;
+	}
+	job->result = ZipIndex_CheckCRC32(entry, job->data);
+}
+
+static void ZipWorker_Run(void) {
+	int i;
+	for (;;) 
+	{
+		if (zip_jobs.mutex) Mutex_Lock(zip_jobs.mutex);
+		i = zip_jobs.next++;
+		if (zip_jobs.mutex) Mutex_Unlock(zip_jobs.mutex);
+
+		if (i >= zip_jobs.count) return;
+		ZipJob_Decompress(&zip_jobs.jobs[i]);
+	}
+}
+
+/* Decompresses all the entries in the current batch, using worker threads if possible */
+static void ZipIndex_DecompressBatch(cc_uint32 rawSize) {
+#if defined CC_BUILD_COOPTHREADED
+	ZipWorker_Run();
+#else
+	void* threads[ZIP_WORKERS_COUNT - 1];
+	int i, numThreads = 0;
+
+	if (zip_jobs.count > 1 && rawSize >= ZIP_PARALLEL_MIN_SIZE) {
+		numThreads = min(zip_jobs.count, ZIP_WORKERS_COUNT) - 1;
+		zip_jobs.mutex = Mutex_Create("Zip jobs");
+	}
+
+	for (i = 0; i < numThreads; i++)
+	{
+		Thread_Run(&threads[i], ZipWorker_Run, 64 * 1024, "Zip worker");
+	}
+	/* This thread decompresses entries too, rather than just waiting around */
+	ZipWorker_Run();
+
+	for (i = 0; i < numThreads; i++) { Thread_Join(threads[i]); }
+	if (zip_jobs.mutex) Mutex_Free(zip_jobs.mutex);
+	zip_jobs.mutex = NULL;
+#endif
+}
+
+/* Decompresses and then processes all the entries in the current batch */
+static cc_result ZipIndex_ProcessBatch(Zip_ProcessEntry processor, cc_uint32 rawSize) {
+	struct ZipIndex* index = zip_jobs.index;
+	struct ZipJob* job;
+	struct Stream stream;
+	cc_string path;
+	cc_result res = 0;
+	int i;
+
+	zip_jobs.next = 0;
+	ZipIndex_DecompressBatch(rawSize);
+
+	for (i = 0; i < zip_jobs.count; i++) 
+	{
+		job = &zip_jobs.jobs[i];
+		if (!res) res = job->result;
+
+		if (!res) {
+			path = StringsBuffer_UNSAFE_Get(&index->paths, job->index);
+			Stream_ReadonlyMemory(&stream, job->data, index->entries[job->index].UncompressedSize);
+			res  = processor(&path, &stream, &index->entries[job->index]);
+		}
+
+		if (job->data != job->raw) Mem_Free(job->data);
+		Mem_Free(job->raw);
+	}
+
+	zip_jobs.count = 0;
+	return res;
+}
+
+/* Reads the raw data of the given entry, adding it to the current batch */
+static cc_result ZipIndex_QueueEntry(int i, cc_uint32* rawSize) {
+	struct ZipIndex* index = zip_jobs.index;
+	struct ZipEntry* entry = &index->entries[i];
+	struct ZipJob* job;
+	cc_uint32 size;
+	int method;
+	cc_result res;
+
+	if ((res = Zip_SeekEntryData(index->source, entry, &method))) return res;
+	if (method != 0 && method != 8) {
+		Platform_Log1("Unsupported.zip entry compression method: %i", &method);
+		return 0;
+	}
+
+	size = method == 0 ? entry->UncompressedSize : entry->CompressedSize;
+	job  = &zip_jobs.jobs[zip_jobs.count];
+	job->raw = (cc_uint8*)Mem_TryAlloc(size + 1, 1);
+	if (!job->raw) return ERR_OUT_OF_MEMORY;
+
+	if ((res = Stream_Read(index->source, job->raw, size))) {
+		Mem_Free(job->raw); return res;
+	}
+
+	job->index  = i;
+	job->method = method;
+	job->data   = NULL;
+	zip_jobs.count++;
+	*rawSize += size;
+	return 0;
+}
+
+cc_result ZipIndex_ExtractAll(struct ZipIndex* index, Zip_SelectEntry selector, Zip_ProcessEntry processor) {
+	struct ZipJob jobs[ZIP_BATCH_MAX_ENTRIES];
+	struct ZipEntry* entry;
+	cc_uint32 rawSize = 0;
+	cc_string path;
+	cc_result res = 0;
+	int i;
+	/* Only one archive can be extracted at a time (e.g. processor might extract another archive) */
+	if (zip_jobs.inUse) return ERR_NOT_SUPPORTED;
+
+	zip_jobs.inUse = true;
+	zip_jobs.index = index;
+	zip_jobs.jobs  = jobs;
+	zip_jobs.count = 0;
+
+	for (i = 0; i < index->count && !res; i++) 
+	{
+		path  = StringsBuffer_UNSAFE_Get(&index->paths, i);
+		if (!selector(&path)) continue;
+		entry = &index->entries[i];
+
+		if (entry->CompressedSize > ZIP_ENTRY_MAX_SIZE || entry->UncompressedSize > ZIP_ENTRY_MAX_SIZE) {
+			/* Entries must still be processed in archive order */
+			if (zip_jobs.count) res = ZipIndex_ProcessBatch(processor, rawSize);
+			rawSize = 0;
+
+			if (!res) res = ZipIndex_StreamEntry(index, i, processor);
+			continue;
+		}
+		res = ZipIndex_QueueEntry(i, &rawSize);
+
+		if (res || (zip_jobs.count < ZIP_BATCH_MAX_ENTRIES && rawSize < ZIP_BATCH_MAX_SIZE)) continue;
+		res     = ZipIndex_ProcessBatch(processor, rawSize);
+		rawSize = 0;
+	}
+
+	if (res) {
+		/* Still need to free the data of entries in the partial batch */
+		for (i = 0; i < zip_jobs.count; i++) { Mem_Free(jobs[i].raw); }
+	} else if (zip_jobs.count) {
+		res = ZipIndex_ProcessBatch(processor, rawSize);
+	}
+
+	zip_jobs.inUse = false;
+	return res;
+}
+#endif
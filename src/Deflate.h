@@ -1,6 +1,6 @@
 #ifndef CC_DEFLATE_H
 #define CC_DEFLATE_H
-#include "Core.h"
+#include "String.h"
 CC_BEGIN_HEADER
 
 /* Decodes data compressed using DEFLATE in a streaming manner.
@@ -87,8 +87,17 @@ CC_API void Inflate_MakeStream2(struct Stream* stream, struct InflateState* stat
 #define DEFLATE_BLOCK_SIZE  16384
 #define DEFLATE_BUFFER_SIZE 32768
 #define DEFLATE_OUT_SIZE 8192
-#define DEFLATE_HASH_SIZE 0x1000UL
-#define DEFLATE_HASH_MASK 0x0FFFUL
+#define DEFLATE_HASH_BITS 14
+#define DEFLATE_HASH_SIZE (1UL << DEFLATE_HASH_BITS)
+
+/* Compression levels, trading off between compression speed and compressed size */
+enum DEFLATE_LEVEL_ {
+	DEFLATE_LEVEL_FAST,    /* Fastest compression, but larger output */
+	DEFLATE_LEVEL_DEFAULT, /* Balance of speed and compressed size */
+	DEFLATE_LEVEL_MAX,     /* Smallest output, but slower compression */
+	DEFLATE_LEVEL_COUNT
+};
+
 struct DeflateState {
 	cc_uint32 Bits;         /* Holds bits across byte boundaries */
 	cc_uint32 NumBits;      /* Number of bits in Bits buffer */
@@ -98,19 +107,38 @@ struct DeflateState {
 	cc_uint32 AvailOut;   /* Max number of bytes that can be written to Output buffer */
 	struct Stream* Dest; /* Destination that Output buffer is written to */
 
-	cc_uint16 LitsCodewords[INFLATE_MAX_LITS]; /* Codewords for each value */
-	cc_uint8 LitsLens[INFLATE_MAX_LITS];       /* Bit lengths of each codeword */
+	cc_uint16 LitsCodewords[INFLATE_MAX_LITS];   /* Codewords for each value */
+	cc_uint8 LitsLens[INFLATE_MAX_LITS];         /* Bit lengths of each codeword */
+	cc_uint16 DistsCodewords[INFLATE_MAX_DISTS]; /* Codewords for each distance code */
+	cc_uint8 DistsLens[INFLATE_MAX_DISTS];       /* Bit lengths of each distance codeword */
+	cc_uint16 LitsFreqs[INFLATE_MAX_LITS];   /* Number of times each value occurs in current block */
+	cc_uint16 DistsFreqs[INFLATE_MAX_DISTS]; /* Number of times each distance code occurs in current block */
 	
 	cc_uint8 Input[DEFLATE_BUFFER_SIZE];
 	cc_uint8 Output[DEFLATE_OUT_SIZE];
-	cc_uint16 Head[DEFLATE_HASH_SIZE];
-	cc_uint16 Prev[DEFLATE_BUFFER_SIZE];
-	/* NOTE: The largest possible value that can get */
-	/*  stored in Head/Prev is <= DEFLATE_BUFFER_SIZE */
-	cc_bool WroteHeader;
+	/* Hash chains used to find matches, allocated when first needed */
+	/* NOTE: Allocated separately so that this struct (which plugins may embed) stays small */
+	struct DeflateTables* Tables;
+	cc_uint32 WindowStart; /* Stream position of first byte in Input */
+
+	/* Literals and length-distance pairs in the current block, before being huffman encoded */
+	/* (literals take up 1 byte, and pairs take 3 bytes, so at most 1 byte per input byte) */
+	cc_uint8 Symbols[DEFLATE_BLOCK_SIZE];
+	cc_uint8 SymbolFlags[DEFLATE_BLOCK_SIZE / 8]; /* Bit set for each symbol that is a pair */
+	cc_uint32 NumSymbols, SymbolsLength;
+	/* Compression level, see DEFLATE_LEVEL_ enum. Defaults to DEFLATE_LEVEL_DEFAULT. */
+	/* NOTE: Can be changed after calling Deflate/GZip/ZLib_MakeStream, before writing any data */
+	cc_uint8 Level;
+	/* Whether compression can switch to using multiple threads once enough data has been written */
+	/* NOTE: Can be changed after calling Deflate/GZip/ZLib_MakeStream, before writing any data */
+	cc_bool AllowParallel;
+	cc_bool Parallel;     /* Whether compression is currently being done on multiple threads */
+	cc_uint32 TotalInput; /* Number of bytes compressed so far */
 };
 /* Compresses input data using DEFLATE, then writes compressed output to another stream. Write only stream. */
 /* DEFLATE compression is pure compressed data, there is no header or footer. */
+/* NOTE: Once done writing, Close must be called to free hash chains and stop any worker threads. */
+/*  (not needed if Write or Close returns an error, as these are then already freed and stopped) */
 CC_API void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying);
 
 struct GZipState { struct DeflateState Base; cc_uint32 Crc32, Size; };
@@ -126,7 +154,7 @@ CC_API  void ZLib_MakeStream(      struct Stream* stream, struct ZLibState* stat
 typedef void (*FP_ZLib_MakeStream)(struct Stream* stream, struct ZLibState* state, struct Stream* underlying);
 
 /* Minimal data needed to describe an entry in a .zip archive */
-struct ZipEntry { cc_uint32 CompressedSize, UncompressedSize, LocalHeaderOffset; };
+struct ZipEntry { cc_uint32 CompressedSize, UncompressedSize, LocalHeaderOffset, CRC32; };
 /* Callback function to process the data in a .zip archive entry */
 /* Return non-zero to indicate an error and stop further processing */
 /* NOTE: data stream MAY NOT be seekable (i.e. entry data might be compressed) */
@@ -138,5 +166,32 @@ typedef cc_bool (*Zip_SelectEntry)(const cc_string* path);
 cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_ProcessEntry processor,
 						struct ZipEntry* entries, int maxEntries);
 
+/* Index of all the entries in a .zip archive, which allows individual entries */
+/*  to be looked up and opened by path, without reading through the whole archive */
+struct ZipIndex {
+	struct Stream* source;
+	struct ZipEntry* entries;   /* Sizes, offset and CRC32 of each entry */
+	struct StringsBuffer paths; /* Path of each entry */
+	int count;
+};
+/* Reads the central directory of a .zip archive, building up an index of all its entries */
+/* NOTE: source must be seekable, and must stay open while the index is being used */
+/* NOTE: ZipIndex_Free must always be called afterwards, even if an error is returned */
+cc_result ZipIndex_Read(struct ZipIndex* index, struct Stream* source);
+/* Frees memory allocated for the given index */
+void ZipIndex_Free(struct ZipIndex* index);
+/* Returns the index of the entry with the given path (case insensitive), or -1 if there isn't one */
+int ZipIndex_Find(struct ZipIndex* index, const cc_string* path);
+/* Reads all the decompressed data of the i'th entry into a newly allocated buffer */
+/* NOTE: You must Mem_Free the returned data */
+/* NOTE: Returns ZIP_ERR_CRC32 if the data doesn't match the CRC32 in the archive */
+cc_result ZipIndex_ReadEntry(struct ZipIndex* index, int i, cc_uint8** data);
+/* Decompresses all entries selected by selector (using worker threads when possible), */
+/*  then calls processor on them in the order they are stored in the archive. */
+/* NOTE: processor is always called on the calling thread */
+/* NOTE: Returns ZIP_ERR_CRC32 if an entry's data doesn't match the CRC32 in the archive */
+/*  (for entries streamed to processor, only checked if processor reads all the data) */
+cc_result ZipIndex_ExtractAll(struct ZipIndex* index, Zip_SelectEntry selector, Zip_ProcessEntry processor);
+
 CC_END_HEADER
 #endif
@@ -440,6 +440,145 @@ void Entity_LerpAngles(struct Entity* e, float t) {
 }
 
 
+/*########################################################################################################################*
+*------------------------------------------------------Entities grid------------------------------------------------------*
+*#########################################################################################################################*/
+/* Entities are bucketed by the chunk column their position is in, so proximity */
+/*  queries only need to look at entities in nearby columns instead of every entity */
+#define GRID_BUCKETS 256
+/* Bucket for entities whose bounds are too large to be found by checking adjacent columns */
+#define GRID_LARGE   GRID_BUCKETS
+#define GRID_NONE    -1
+/* Entities whose bounds extend further than this from their position go in GRID_LARGE */
+#define GRID_MAX_EXTENT HALF_CHUNK_SIZE
+
+static cc_int16 grid_heads[GRID_BUCKETS + 1];
+static cc_int16 grid_next[ENTITIES_MAX_COUNT];
+static cc_int16 grid_bucket[ENTITIES_MAX_COUNT];
+static int grid_cellX[ENTITIES_MAX_COUNT], grid_cellZ[ENTITIES_MAX_COUNT];
+/* Bounds of all columns which contain at least one entity */
+static int grid_minX, grid_minZ, grid_maxX, grid_maxZ;
+static cc_bool grid_boundsDirty;
+
+static int EntityGrid_Bucket(int cellX, int cellZ) {
+	cc_uint32 hash = ((cc_uint32)cellX * 73856093u) ^ ((cc_uint32)cellZ * 19349663u);
+	return (int)(hash & (GRID_BUCKETS - 1));
+}
+
+static cc_bool EntityGrid_IsLarge(struct Entity* e) {
+	struct AABB* bb = &e->ModelAABB;
+	float x = max(Math_AbsF(bb->Min.x), Math_AbsF(bb->Max.x));
+	float y = max(Math_AbsF(bb->Min.y), Math_AbsF(bb->Max.y));
+	float z = max(Math_AbsF(bb->Min.z), Math_AbsF(bb->Max.z));
+	/* Rotated picking bounds can extend up to the furthest corner in any direction */
+	return x * x + y * y + z * z > GRID_MAX_EXTENT * GRID_MAX_EXTENT;
+}
+
+static void EntityGrid_Unlink(int id) {
+	int bucket = grid_bucket[id];
+	cc_int16* cur;
+	if (bucket == GRID_NONE) return;
+
+	for (cur = &grid_heads[bucket]; *cur != GRID_NONE; cur = &grid_next[*cur])
+	{
+		if (*cur != id) continue;
+		*cur = grid_next[id]; break;
+	}
+	grid_bucket[id]  = GRID_NONE;
+	grid_boundsDirty = true;
+}
+
+/* Moves the given entity into the bucket for the chunk column it is currently in */
+static void EntityGrid_Update(int id) {
+	struct Entity* e = Entities.List[id];
+	int cellX, cellZ, bucket;
+	if (!e) { EntityGrid_Unlink(id); return; }
+
+	cellX  = Math_Floor(e->Position.x) >> CHUNK_SHIFT;
+	cellZ  = Math_Floor(e->Position.z) >> CHUNK_SHIFT;
+	bucket = EntityGrid_IsLarge(e) ? GRID_LARGE : EntityGrid_Bucket(cellX, cellZ);
+
+	if (grid_bucket[id] == bucket && grid_cellX[id] == cellX && grid_cellZ[id] == cellZ) return;
+	EntityGrid_Unlink(id);
+
+	grid_cellX[id]     = cellX;
+	grid_cellZ[id]     = cellZ;
+	grid_bucket[id]    = bucket;
+	grid_next[id]      = grid_heads[bucket];
+	grid_heads[bucket] = id;
+}
+
+static void EntityGrid_Reset(void) {
+	int i;
+	for (i = 0; i <= GRID_BUCKETS;      i++) grid_heads[i]  = GRID_NONE;
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) grid_bucket[i] = GRID_NONE;
+	grid_boundsDirty = true;
+}
+
+static void EntityGrid_CalcBounds(void) {
+	int i;
+	grid_minX = Int32_MaxValue; grid_maxX = Int32_MinValue;
+	grid_minZ = Int32_MaxValue; grid_maxZ = Int32_MinValue;
+	grid_boundsDirty = false;
+
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++)
+	{
+		if (grid_bucket[i] == GRID_NONE || grid_bucket[i] == GRID_LARGE) continue;
+		grid_minX = min(grid_minX, grid_cellX[i]); grid_maxX = max(grid_maxX, grid_cellX[i]);
+		grid_minZ = min(grid_minZ, grid_cellZ[i]); grid_maxZ = max(grid_maxZ, grid_cellZ[i]);
+	}
+}
+
+/* Adds IDs of all entities in the given chunk column that have not already been found */
+static int EntityGrid_AddCell(int cellX, int cellZ, cc_uint8* found, int* ids, int count) {
+	int id = grid_heads[EntityGrid_Bucket(cellX, cellZ)];
+
+	for (; id != GRID_NONE; id = grid_next[id])
+	{
+		if (found[id] || grid_cellX[id] != cellX || grid_cellZ[id] != cellZ) continue;
+		found[id] = true; ids[count++] = id;
+	}
+	return count;
+}
+
+static int EntityGrid_AddLarge(cc_uint8* found, int* ids, int count) {
+	int id = grid_heads[GRID_LARGE];
+
+	for (; id != GRID_NONE; id = grid_next[id])
+	{
+		if (found[id]) continue;
+		found[id] = true; ids[count++] = id;
+	}
+	return count;
+}
+
+int Entities_Query(const struct AABB* bb, int* ids) {
+	cc_uint8 found[ENTITIES_MAX_COUNT] = { 0 };
+	int minX = Math_Floor(bb->Min.x - GRID_MAX_EXTENT) >> CHUNK_SHIFT;
+	int minZ = Math_Floor(bb->Min.z - GRID_MAX_EXTENT) >> CHUNK_SHIFT;
+	int maxX = Math_Floor(bb->Max.x + GRID_MAX_EXTENT) >> CHUNK_SHIFT;
+	int maxZ = Math_Floor(bb->Max.z + GRID_MAX_EXTENT) >> CHUNK_SHIFT;
+	int x, z, count;
+
+	/* Very large areas are better handled by just checking every entity */
+	if ((maxX - minX + 1) * (maxZ - minZ + 1) > GRID_BUCKETS) {
+		for (x = 0, count = 0; x < ENTITIES_MAX_COUNT; x++)
+		{
+			if (Entities.List[x]) ids[count++] = x;
+		}
+		return count;
+	}
+
+	count = EntityGrid_AddLarge(found, ids, 0);
+	for (z = minZ; z <= maxZ; z++)
+		for (x = minX; x <= maxX; x++)
+		{
+			count = EntityGrid_AddCell(x, z, found, ids, count);
+		}
+	return count;
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------Entities---------------------------------------------------------*
 *#########################################################################################################################*/
@@ -451,18 +590,23 @@ void Entities_Tick(struct ScheduledTask* task) {
 	{
 		if (!Entities.List[i]) continue;
 		Entities.List[i]->VTABLE->Tick(Entities.List[i], task->interval);
+		EntityGrid_Update(i);
 	}
 }
 
 void Entities_RenderModels(float delta, float t) {
 	int i;
 	Gfx_SetAlphaTest(true);
+	Model_BeginBatch();
 	
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
 	{
 		if (!Entities.List[i]) continue;
 		Entities.List[i]->VTABLE->RenderModel(Entities.List[i], delta, t);
+		EntityGrid_Update(i);
 	}
+
+	Model_EndBatch();
 	Gfx_SetAlphaTest(false);
 }
 
@@ -491,6 +635,7 @@ void Entities_Remove(int id) {
 	Event_RaiseInt(&EntityEvents.Removed, id);
 	e->VTABLE->Despawn(e);
 	Entities.List[id] = NULL;
+	EntityGrid_Unlink(id);
 
 	/* TODO: Move to EntityEvents.Removed callback instead */
 	if (id < TABLIST_MAX_NAMES && TabList_EntityLinked_Get(id)) {
@@ -499,25 +644,73 @@ void Entities_Remove(int id) {
 	}
 }
 
+static void Entities_PickClosest(Vec3 eyePos, Vec3 dir, int* ids, int count, float* closestDist, int* targetID) {
+	struct Entity* e;
+	float t0, t1;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		e = Entities.List[ids[i]];
+		/* because we don't want to pick against local player */
+		if (!e || e == &Entities.CurPlayer->Base) continue;
+		if (!Intersection_RayIntersectsRotatedBox(eyePos, dir, e, &t0, &t1)) continue;
+
+		if (*targetID == -1 || t0 < *closestDist) {
+			*closestDist = t0;
+			*targetID    = ids[i];
+		}
+	}
+}
+
 int Entities_GetClosest(struct Entity* src) {
 	Vec3 eyePos = Entity_GetEyePosition(src);
 	Vec3 dir    = Vec3_GetDirVector(src->Yaw * MATH_DEG2RAD, src->Pitch * MATH_DEG2RAD);
 	float closestDist = -200; /* NOTE: was previously positive infinity */
 	int targetID = -1;
 
-	float t0, t1;
-	int i;
+	cc_uint8 found[ENTITIES_MAX_COUNT] = { 0 };
+	int ids[ENTITIES_MAX_COUNT];
+	int cellX, cellZ, stepX, stepZ, x, z, count;
+	float tMaxX, tMaxZ, tDeltaX, tDeltaZ, tEntry;
 
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) /* because we don't want to pick against local player */
+	count = EntityGrid_AddLarge(found, ids, 0);
+	Entities_PickClosest(eyePos, dir, ids, count, &closestDist, &targetID);
+	if (grid_boundsDirty) EntityGrid_CalcBounds();
+
+	/* Walk the chunk columns the ray passes through in order of distance */
+	/*  (an entity can only be hit from its own column or an adjacent one) */
+	cellX = Math_Floor(eyePos.x) >> CHUNK_SHIFT; stepX = dir.x >= 0.0f ? 1 : -1;
+	cellZ = Math_Floor(eyePos.z) >> CHUNK_SHIFT; stepZ = dir.z >= 0.0f ? 1 : -1;
+
+	tDeltaX = dir.x ? CHUNK_SIZE / Math_AbsF(dir.x) : MATH_LARGENUM;
+	tDeltaZ = dir.z ? CHUNK_SIZE / Math_AbsF(dir.z) : MATH_LARGENUM;
+	tMaxX   = dir.x ? ((cellX + (stepX > 0)) * CHUNK_SIZE - eyePos.x) / dir.x : MATH_LARGENUM;
+	tMaxZ   = dir.z ? ((cellZ + (stepZ > 0)) * CHUNK_SIZE - eyePos.z) / dir.z : MATH_LARGENUM;
+	tEntry  = 0.0f;
+
+	for (;;)
 	{
-		struct Entity* e = Entities.List[i];
-		if (!e || e == &Entities.CurPlayer->Base) continue;
-		if (!Intersection_RayIntersectsRotatedBox(eyePos, dir, e, &t0, &t1)) continue;
+		if (targetID != -1 && tEntry > closestDist) break;
+		/* Stop once the ray has moved past all columns containing entities */
+		if ((cellX < grid_minX - 1 && stepX < 0) || (cellX > grid_maxX + 1 && stepX > 0)) break;
+		if ((cellZ < grid_minZ - 1 && stepZ < 0) || (cellZ > grid_maxZ + 1 && stepZ > 0)) break;
+
+		count = 0;
+		for (z = cellZ - 1; z <= cellZ + 1; z++)
+			for (x = cellX - 1; x <= cellX + 1; x++)
+			{
+				count = EntityGrid_AddCell(x, z, found, ids, count);
+			}
+		Entities_PickClosest(eyePos, dir, ids, count, &closestDist, &targetID);
 
-		if (targetID == -1 || t0 < closestDist) {
-			closestDist = t0;
-			targetID    = i;
+		if (tMaxX < tMaxZ) {
+			tEntry = tMaxX; tMaxX += tDeltaX; cellX += stepX;
+		} else {
+			tEntry = tMaxZ; tMaxZ += tDeltaZ; cellZ += stepZ;
 		}
+		/* Ray is vertical, so never leaves the starting column */
+		if (tEntry >= MATH_LARGENUM) break;
 	}
 	return targetID;
 }
@@ -1141,6 +1334,7 @@ static void Entities_Init(void) {
 	}
 	Entities.CurPlayer = &LocalPlayer_Instances[0];
 	LocalPlayer_HookBinds();
+	EntityGrid_Reset();
 }
 
 static void Entities_Free(void) {
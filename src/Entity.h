@@ -184,6 +184,10 @@ void Entities_Remove(int id);
 /* Gets the ID of the closest entity to the given entity */
 /* Returns -1 if there is no other entity nearby */
 int Entities_GetClosest(struct Entity* src);
+/* Retrieves the IDs of all entities whose position is near the given bounds */
+/* NOTE: This is only a broadphase check, callers must still test each entity */
+/* Returns number of IDs written into ids (which must have room for ENTITIES_MAX_COUNT) */
+int Entities_Query(const struct AABB* bb, int* ids);
 
 #define TABLIST_MAX_NAMES 256
 /* Data for all entries in tab list */
@@ -1030,15 +1030,22 @@ float PhysicsComp_CalcJumpVelocity(float jumpHeight) {
 }
 
 void PhysicsComp_DoEntityPush(struct Entity* entity) {
+	static const Vec3 pushRange = { 1.0f, 0.0f, 1.0f };
 	struct Entity* other;
 	cc_bool yIntersects;
+	struct AABB bb;
 	Vec3 dir;
 	float dist, pushStrength;
-	int id;
+	int ids[ENTITIES_MAX_COUNT];
+	int i, count;
 	dir.y = 0.0f;
 
-	for (id = 0; id < ENTITIES_MAX_COUNT; id++) {
-		other = Entities.List[id];
+	Vec3_Sub(&bb.Min, &entity->Position, &pushRange);
+	Vec3_Add(&bb.Max, &entity->Position, &pushRange);
+	count = Entities_Query(&bb, ids);
+
+	for (i = 0; i < count; i++) {
+		other = Entities.List[ids[i]];
 		if (!other || other == entity) continue;
 		if (!other->Model->pushes)     continue;
 
@@ -11,6 +11,7 @@
 #include "World.h"
 #include "Particle.h"
 #include "Drawer2D.h"
+#include "Platform.h"
 
 /*########################################################################################################################*
 *------------------------------------------------------Entity Shadow------------------------------------------------------*
@@ -275,14 +276,161 @@ void EntityShadows_Render(void) {
 }
 
 
+/*########################################################################################################################*
+*------------------------------------------------------Nametag atlas------------------------------------------------------*
+*#########################################################################################################################*/
+/* Nametags are packed into rows ('shelves') of one shared texture, so that all names can be drawn */
+/*  with just one texture bind. When the atlas is full, the least recently drawn shelf is reused. */
+#define NAMES_MAX_SHELVES 64
+#define NAMES_PADDING 1
+struct NameShelf { int y, height, x; cc_uint32 lastUsed; cc_uint16 gen; };
+
+static GfxResourceID names_atlas;
+static int names_atlasWidth, names_atlasHeight, names_numShelves;
+static struct NameShelf names_shelves[NAMES_MAX_SHELVES];
+static cc_uint32 names_frame;
+static cc_uint16 names_nextGen;
+static cc_bool names_atlasFailed;
+/* Shelf and shelf generation each entity's name was allocated in */
+static cc_uint8  names_entityShelf[ENTITIES_MAX_COUNT];
+static cc_uint16 names_entityGen[ENTITIES_MAX_COUNT];
+
+static void NameAtlas_Reset(void) {
+	names_numShelves = 0;
+}
+
+static cc_bool NameAtlas_Create(void) {
+	struct Bitmap bmp;
+	int size;
+	if (names_atlas) return true;
+	/* Atlas relies on drawing only part of the texture */
+	if (names_atlasFailed || Gfx.NoUVSupport) return false;
+
+	for (size = 1024; size >= 256; size >>= 1) 
+	{
+		if (Gfx_CheckTextureSize(size, size, TEXTURE_FLAG_DYNAMIC)) break;
+	}
+	if (size < 256) { names_atlasFailed = true; return false; }
+
+	bmp.width  = size; bmp.height = size;
+	bmp.scan0  = (BitmapCol*)Mem_TryAllocCleared(size * size, BITMAPCOLOR_SIZE);
+	if (!bmp.scan0) { names_atlasFailed = true; return false; }
+
+	names_atlas = Gfx_CreateTexture(&bmp, TEXTURE_FLAG_DYNAMIC, false);
+	Mem_Free(bmp.scan0);
+	if (!names_atlas) { names_atlasFailed = true; return false; }
+
+	names_atlasWidth  = size;
+	names_atlasHeight = size;
+	NameAtlas_Reset();
+	return true;
+}
+
+/* Finds space in the atlas for a name of the given size, returning the shelf index or -1 if none */
+static int NameAtlas_Alloc(int width, int height, int* x, int* y) {
+	struct NameShelf* shelf;
+	int i, best = -1, top;
+	width += NAMES_PADDING; height += NAMES_PADDING;
+	if (width > names_atlasWidth) return -1;
+
+	/* Use the shortest shelf which still has enough room */
+	for (i = 0; i < names_numShelves; i++) 
+	{
+		shelf = &names_shelves[i];
+		if (height > shelf->height || shelf->x + width > names_atlasWidth) continue;
+		if (best == -1 || shelf->height < names_shelves[best].height) best = i;
+	}
+
+	/* Otherwise start a new shelf underneath the existing ones */
+	if (best == -1) {
+		top = names_numShelves ? names_shelves[names_numShelves - 1].y + names_shelves[names_numShelves - 1].height : 0;
+
+		if (names_numShelves < NAMES_MAX_SHELVES && top + height <= names_atlasHeight) {
+			best  = names_numShelves++;
+			shelf = &names_shelves[best];
+			shelf->y = top; shelf->height = height; shelf->x = 0; shelf->gen = ++names_nextGen;
+		}
+	}
+
+	/* Otherwise evict the least recently used shelf (but not one already drawn this frame) */
+	if (best == -1) {
+		for (i = 0; i < names_numShelves; i++) 
+		{
+			shelf = &names_shelves[i];
+			if (height > shelf->height || shelf->lastUsed == names_frame) continue;
+			if (best == -1 || shelf->lastUsed < names_shelves[best].lastUsed) best = i;
+		}
+		if (best == -1) return -1;
+
+		shelf = &names_shelves[best];
+		shelf->x = 0; shelf->gen = ++names_nextGen;
+	}
+
+	shelf = &names_shelves[best];
+	*x = shelf->x; *y = shelf->y;
+	shelf->x += width;
+	shelf->lastUsed = names_frame;
+	return best;
+}
+
+static cc_bool NameAtlas_Add(int id, struct Entity* e, struct Context2D* ctx) {
+	struct Bitmap part;
+	int x, y, shelf;
+	if (id < 0 || !NameAtlas_Create()) return false;
+
+	shelf = NameAtlas_Alloc(ctx->width, ctx->height, &x, &y);
+	if (shelf == -1) return false;
+
+	part.scan0  = ctx->bmp.scan0;
+	part.width  = ctx->width;
+	part.height = ctx->height;
+	Gfx_UpdateTexture(names_atlas, x, y, &part, ctx->bmp.width, false);
+
+	names_entityShelf[id] = shelf;
+	names_entityGen[id]   = names_shelves[shelf].gen;
+
+	e->NameTex.ID     = names_atlas;
+	e->NameTex.width  = ctx->width;
+	e->NameTex.height = ctx->height;
+	e->NameTex.uv.u1  = (float)x / names_atlasWidth;
+	e->NameTex.uv.v1  = (float)y / names_atlasHeight;
+	e->NameTex.uv.u2  = (float)(x + ctx->width)  / names_atlasWidth;
+	e->NameTex.uv.v2  = (float)(y + ctx->height) / names_atlasHeight;
+	return true;
+}
+
+/* Checks whether the given entity's name is still in the atlas, and marks it as recently used */
+static void NameAtlas_Touch(int id, struct Entity* e) {
+	struct NameShelf* shelf;
+	if (!names_atlas || e->NameTex.ID != names_atlas) return;
+
+	if (names_entityShelf[id] >= names_numShelves) { e->NameTex.ID = 0; return; }
+	shelf = &names_shelves[names_entityShelf[id]];
+
+	/* Shelf was since evicted and reused for other names */
+	if (shelf->gen != names_entityGen[id]) { e->NameTex.ID = 0; return; }
+	shelf->lastUsed = names_frame;
+}
+
+static void NameAtlas_Free(void) {
+	Gfx_DeleteTexture(&names_atlas);
+	NameAtlas_Reset();
+	names_atlasFailed = false;
+}
+
+
 /*########################################################################################################################*
 *-----------------------------------------------------Entity nametag------------------------------------------------------*
 *#########################################################################################################################*/
 static GfxResourceID names_VB;
 #define NAME_IS_EMPTY -30000
 #define NAME_OFFSET 3 /* offset of back layer of name above an entity */
+/* Names in the atlas are drawn together in batches of at most this many names */
+#define NAMES_BATCH_MAX 64
+static struct VertexTextured names_vertices[NAMES_BATCH_MAX * 4];
+static int names_count;
 
-static void MakeNameTexture(struct Entity* e) {
+static void MakeNameTexture(int id, struct Entity* e) {
 	cc_string colorlessName; char colorlessBuffer[STRING_SIZE];
 	BitmapCol shadowColor = BitmapCol_Make(80, 80, 80, 255);
 	BitmapCol origWhiteColor;
@@ -323,13 +471,26 @@ static void MakeNameTexture(struct Entity* e) {
 			args.text = name;
 			Context2D_DrawText(&ctx, &args, 0, 0);
 		}
-		Context2D_MakeTexture(&e->NameTex, &ctx);
+		/* Very long names (or no room left in atlas) fallback to using a separate texture */
+		if (!NameAtlas_Add(id, e, &ctx)) Context2D_MakeTexture(&e->NameTex, &ctx);
 		Context2D_Free(&ctx);
 	}
 }
 
-static void DrawName(struct Entity* e) {
-	struct VertexTextured* vertices;
+static void FlushNames(void) {
+	if (!names_count) return;
+	if (!names_VB)
+		names_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, NAMES_BATCH_MAX * 4);
+
+	Gfx_BindTexture(names_atlas);
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Gfx_SetDynamicVbData(names_VB, names_vertices, names_count * 4);
+	Gfx_DrawVb_IndexedTris(names_count * 4);
+	names_count = 0;
+}
+
+static void DrawName(int id, struct Entity* e) {
+	struct VertexTextured vertices[4];
 	struct Model* model;
 	struct Matrix mat, transform;
 	Vec3 pos;
@@ -338,11 +499,9 @@ static void DrawName(struct Entity* e) {
 
 	if (!e->VTABLE->ShouldRenderName(e)) return;
 	if (e->NameTex.x == NAME_IS_EMPTY)   return;
-	if (!e->NameTex.ID) MakeNameTexture(e);
-	Gfx_BindTexture(e->NameTex.ID);
-
-	if (!names_VB)
-		names_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, 4);
+	NameAtlas_Touch(id, e);
+	if (!e->NameTex.ID) MakeNameTexture(id, e);
+	if (!e->NameTex.ID) return;
 
 	model = e->Model;
 	Model_GetEntityTransform(model, e, &transform);
@@ -359,17 +518,30 @@ static void DrawName(struct Entity* e) {
 		size.x *= scale * 0.2f; size.y *= scale * 0.2f;
 	}
 
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	if (e->NameTex.ID == names_atlas) {
+		Particle_DoRender(&size, &pos, &e->NameTex.uv, PACKEDCOL_WHITE, &names_vertices[names_count * 4]);
+		if (++names_count == NAMES_BATCH_MAX) FlushNames();
+		return;
+	}
 
-	vertices = (struct VertexTextured*)Gfx_LockDynamicVb(names_VB, VERTEX_FORMAT_TEXTURED, 4);
-	Particle_DoRender(&size, &pos, &e->NameTex.uv, PACKEDCOL_WHITE, vertices);
-	Gfx_UnlockDynamicVb(names_VB);
+	/* Name has its own texture, so has to be drawn separately */
+	if (!names_VB)
+		names_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, NAMES_BATCH_MAX * 4);
 
+	Gfx_BindTexture(e->NameTex.ID);
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Particle_DoRender(&size, &pos, &e->NameTex.uv, PACKEDCOL_WHITE, vertices);
+	Gfx_SetDynamicVbData(names_VB, vertices, 4);
 	Gfx_DrawVb_IndexedTris(4);
 }
 
 void EntityNames_Delete(struct Entity* e) {
-	Gfx_DeleteTexture(&e->NameTex.ID);
+	/* Names in the atlas don't own the texture */
+	if (e->NameTex.ID == names_atlas) {
+		e->NameTex.ID = 0;
+	} else {
+		Gfx_DeleteTexture(&e->NameTex.ID);
+	}
 	e->NameTex.x = 0; /* X is used as an 'empty name' flag */
 }
 
@@ -384,6 +556,7 @@ void EntityNames_Render(void) {
 	cc_bool hadFog;
 	int i;
 
+	names_frame++;
 	if (Entities.NamesMode == NAME_MODE_NONE) return;
 	closestEntityId = Entities_GetClosest(&p->Base);
 	if (!p->Hacks.CanSeeAllNames || Entities.NamesMode != NAME_MODE_ALL) return;
@@ -395,8 +568,9 @@ void EntityNames_Render(void) {
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
 	{
 		if (!Entities.List[i]) continue;
-		if (i != closestEntityId) DrawName(Entities.List[i]);
+		if (i != closestEntityId) DrawName(i, Entities.List[i]);
 	}
+	FlushNames();
 
 	Gfx_SetAlphaTest(false);
 	if (hadFog) Gfx_SetFog(true);
@@ -407,17 +581,24 @@ void EntityNames_RenderHovered(void) {
 	struct Entity* e;
 	cc_bool allNames, hadFog;
 	cc_bool setupState = false;
-	int i;
+	int i, end;
 
 	if (Entities.NamesMode == NAME_MODE_NONE) return;
 	allNames = !(Entities.NamesMode == NAME_MODE_HOVERED || Entities.NamesMode == NAME_MODE_ALL) 
 		&& p->Hacks.CanSeeAllNames;
 
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+	/* Only the hovered entity's name needs drawing, so avoid checking every entity */
+	if (!allNames) {
+		if (closestEntityId == -1) return;
+		i = closestEntityId; end = i + 1;
+	} else {
+		i = 0; end = ENTITIES_MAX_COUNT;
+	}
+
+	for (; i < end; i++) 
 	{
 		e = Entities.List[i];
 		if (!e || e == &p->Base) continue;
-		if (!allNames && i != closestEntityId) continue;
 
 		/* Only alter the GPU state when actually necessary */
 		if (!setupState) {
@@ -429,10 +610,11 @@ void EntityNames_RenderHovered(void) {
 			hadFog = Gfx_GetFog();
 			if (hadFog) Gfx_SetFog(false);
 		}
-		DrawName(e);
+		DrawName(i, e);
 	}
 
 	if (!setupState) return;
+	FlushNames();
 	Gfx_SetAlphaTest(false);
 	Gfx_SetDepthTest(true);
 	Gfx_SetDepthWrite(true);
@@ -446,6 +628,8 @@ static void DeleteAllNameTextures(void) {
 		if (!Entities.List[i]) continue;
 		EntityNames_Delete(Entities.List[i]);
 	}
+	/* All names have to be remade anyways, so just reuse the whole atlas */
+	NameAtlas_Reset();
 }
 
 static void EntityNames_ChatFontChanged(void* obj) {
@@ -462,6 +646,7 @@ static void EntityRenderers_ContextLost(void* obj) {
 	
 	Gfx_DeleteDynamicVb(&names_VB);
 	DeleteAllNameTextures();
+	NameAtlas_Free();
 }
 
 static void EntityRenderers_Init(void) {
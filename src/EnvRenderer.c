@@ -420,8 +420,8 @@ void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID n
 		Weather_Heightmap[hIndex] = y;
 	} else {
 		/* Part of the column is now visible to rain, we don't know how exactly how high it should be though. */
-		/* However, we know that if the old block was above or equal to rain height, then the new rain height must be <= old block.y */
-		CalcRainHeightAt(x, y, z, hIndex);
+		/* Rather than rescanning the column on every change, just recalculate it when next rendered */
+		Weather_Heightmap[hIndex] = Int16_MaxValue;
 	}
 }
 
@@ -138,5 +138,12 @@ enum CC_ERRORS {
 	SSL_ERR_CONTEXT_DEAD = 0xCCDED070UL, /* Server shutdown the SSL context and it must be recreated */
 	PNG_ERR_16BITSAMPLES = 0xCCDED071UL, /* Image uses 16 bit samples, which is unimplemented */
 	ERR_NO_NETWORKING    = 0xCCDED072UL, /* No working network connection */
+
+	CCMAP_ERR_IDENTIFIER  = 0xCCDED073UL, /* CCMAP stream bytes #1-#4 aren't "CCMF" */
+	CCMAP_ERR_VERSION     = 0xCCDED074UL, /* CCMAP stream byte #5 isn't 1 */
+	CCMAP_ERR_SLICE_SIZE  = 0xCCDED075UL, /* CCMAP total size of compressed slices is too large */
+	CCMAP_ERR_DIMENSIONS  = 0xCCDED076UL, /* CCMAP world width/height/length is 0 or world is too large */
+	ZIP_ERR_CRC32         = 0xCCDED077UL, /* ZIP entry data doesn't match CRC32 in the central directory */
+	ZIP_ERR_PATHS_LENGTH  = 0xCCDED078UL, /* ZIP entry paths are too long in total */
 };
 #endif
@@ -19,6 +19,9 @@
 
 #ifdef CC_BUILD_FILESYSTEM
 static struct LocationUpdate* spawn_point;
+/* Whether a map is being loaded by the map benchmark, which restores the game state afterwards */
+/*  (so importers must avoid side effects that can't be undone, such as defining blocks) */
+static cc_bool map_benchmarking;
 static struct MapImporter* imp_head;
 static struct MapImporter* imp_tail;
 
@@ -343,6 +346,7 @@ struct NbtTag {
 	char _nameBuffer[NBT_STRING_SIZE];
 	cc_result result;
 	int listIndex;
+	int depth; /* number of parent tags */
 };
 
 static cc_uint8 NbtTag_U8(struct NbtTag* tag) {
@@ -398,27 +402,93 @@ static cc_string NbtTag_String(struct NbtTag* tag) {
 	return String_Empty;
 }
 
-static cc_result Nbt_ReadString(struct Stream* stream, cc_string* str) {
-	cc_uint8 buffer[NBT_STRING_SIZE * 4];
-	int len;
+/* Reading each small value directly from the inflate stream has quite a lot of overhead, */
+/*  so values are instead read from a buffer of decompressed data. Large arrays are still */
+/*  decompressed directly into their final destination though (e.g. world blocks). */
+#define NBT_BUFFER_SIZE 4096
+struct NbtReader {
+	struct Stream* source;
+	cc_uint8* cur;  /* Next byte of data in buffer */
+	cc_uint32 left; /* Number of bytes of data left in buffer */
+	cc_uint8 buffer[NBT_BUFFER_SIZE];
+};
+
+/* Ensures that at least count bytes of data are in the buffer */
+/* NOTE: count must be <= NBT_BUFFER_SIZE */
+static cc_result Nbt_Ensure(struct NbtReader* reader, cc_uint32 count) {
+	cc_uint32 read;
 	cc_result res;
+	if (reader->left >= count) return 0;
 
-	if ((res = Stream_Read(stream, buffer, 2)))   return res;
-	len = Stream_GetU16_BE(buffer);
+	Mem_Move(reader->buffer, reader->cur, reader->left);
+	reader->cur = reader->buffer;
+
+	while (reader->left < count) {
+		res = reader->source->Read(reader->source, reader->buffer + reader->left, 
+									NBT_BUFFER_SIZE - reader->left, &read);
+		if (res)   return res;
+		if (!read) return ERR_END_OF_STREAM;
+		reader->left += read;
+	}
+	return 0;
+}
+
+static cc_result Nbt_ReadU8(struct NbtReader* reader, cc_uint8* value) {
+	cc_result res;
+	if ((res = Nbt_Ensure(reader, 1))) return res;
+
+	*value = *reader->cur;
+	reader->cur++; reader->left--;
+	return 0;
+}
+
+static cc_result Nbt_ReadU16(struct NbtReader* reader, cc_uint16* value) {
+	cc_result res;
+	if ((res = Nbt_Ensure(reader, 2))) return res;
+
+	*value = Stream_GetU16_BE(reader->cur);
+	reader->cur += 2; reader->left -= 2;
+	return 0;
+}
+
+static cc_result Nbt_ReadU32(struct NbtReader* reader, cc_uint32* value) {
+	cc_result res;
+	if ((res = Nbt_Ensure(reader, 4))) return res;
+
+	*value = Stream_GetU32_BE(reader->cur);
+	reader->cur += 4; reader->left -= 4;
+	return 0;
+}
+
+/* Reads data from the buffer first, then directly from the source for any remaining data */
+static cc_result Nbt_ReadData(struct NbtReader* reader, cc_uint8* data, cc_uint32 count) {
+	cc_uint32 len = min(count, reader->left);
+	Mem_Copy(data, reader->cur, len);
+
+	reader->cur  += len; reader->left -= len;
+	data         += len; count        -= len;
+	return count ? Stream_Read(reader->source, data, count) : 0;
+}
+
+static cc_result Nbt_ReadString(struct NbtReader* reader, cc_string* str) {
+	cc_uint16 len;
+	cc_result res;
 
-	if (len > Array_Elems(buffer)) return CW_ERR_STRING_LEN;
-	if ((res = Stream_Read(stream, buffer, len))) return res;
+	if ((res = Nbt_ReadU16(reader, &len))) return res;
+	if (len > NBT_STRING_SIZE * 4) return CW_ERR_STRING_LEN;
+	if ((res = Nbt_Ensure(reader, len)))   return res;
 
-	String_AppendUtf8(str, buffer, len);
+	String_AppendUtf8(str, reader->cur, len);
+	reader->cur += len; reader->left -= len;
 	return 0;
 }
 
 typedef void (*Nbt_Callback)(struct NbtTag* tag);
-static cc_result Nbt_ReadTag(cc_uint8 typeId, cc_bool readTagName, struct Stream* stream, 
+static cc_result Nbt_ReadTag(cc_uint8 typeId, cc_bool readTagName, struct NbtReader* reader, 
 							struct NbtTag* parent, Nbt_Callback callback, int listIndex) {
 	struct NbtTag tag;
 	cc_uint8 childType;
-	cc_uint8 tmp[5];	
+	cc_uint32 tmp;
 	cc_result res;
 	cc_uint32 i, count;
 	
@@ -427,65 +497,65 @@ static cc_result Nbt_ReadTag(cc_uint8 typeId, cc_bool readTagName, struct Stream
 	tag.parent    = parent;
 	tag.dataSize  = 0;
 	tag.listIndex = listIndex;
+	tag.depth     = parent ? parent->depth + 1 : 0;
 	String_InitArray(tag.name, tag._nameBuffer);
 
 	if (readTagName) {
-		res = Nbt_ReadString(stream, &tag.name);
+		res = Nbt_ReadString(reader, &tag.name);
 		if (res) return res;
 	}
 
 	switch (typeId) {
 	case NBT_I8:
-		res = stream->ReadU8(stream, &tag.value.u8);
+		res = Nbt_ReadU8(reader, &tag.value.u8);
 		break;
 	case NBT_I16:
-		res = Stream_Read(stream, tmp, 2);
-		tag.value.u16 = Stream_GetU16_BE(tmp);
+		res = Nbt_ReadU16(reader, &tag.value.u16);
 		break;
 	case NBT_I32:
 	case NBT_F32:
-		res = Stream_ReadU32_BE(stream, &tag.value.u32);
+		res = Nbt_ReadU32(reader, &tag.value.u32);
 		break;
 	case NBT_I64:
 	case NBT_F64:
-		res = stream->Skip(stream, 8);
+		res = Nbt_ReadU32(reader, &tmp);
+		if (!res) res = Nbt_ReadU32(reader, &tmp);
 		break; /* (8) data */
 
 	case NBT_I8S:
-		if ((res = Stream_ReadU32_BE(stream, &tag.dataSize))) break;
+		if ((res = Nbt_ReadU32(reader, &tag.dataSize))) break;
 
 		if (NbtTag_IsSmall(&tag)) {
-			res = Stream_Read(stream, tag.value.small, tag.dataSize);
+			res = Nbt_ReadData(reader, tag.value.small, tag.dataSize);
 		} else {
 			tag.value.big = (cc_uint8*)Mem_TryAlloc(tag.dataSize, 1);
 			if (!tag.value.big) return ERR_OUT_OF_MEMORY;
 
-			res = Stream_Read(stream, tag.value.big, tag.dataSize);
+			res = Nbt_ReadData(reader, tag.value.big, tag.dataSize);
 			if (res) Mem_Free(tag.value.big);
 		}
 		break;
 	case NBT_STR:
 		String_InitArray(tag.value.str.text, tag.value.str.buffer);
-		res = Nbt_ReadString(stream, &tag.value.str.text);
+		res = Nbt_ReadString(reader, &tag.value.str.text);
 		break;
 
 	case NBT_LIST:
-		if ((res = Stream_Read(stream, tmp, 5))) break;
-		childType = tmp[0];
-		count = Stream_GetU32_BE(&tmp[1]);
+		if ((res = Nbt_ReadU8(reader, &childType))) break;
+		if ((res = Nbt_ReadU32(reader, &count)))    break;
 
 		for (i = 0; i < count; i++) {
-			res = Nbt_ReadTag(childType, false, stream, &tag, callback, i);
+			res = Nbt_ReadTag(childType, false, reader, &tag, callback, i);
 			if (res) break;
 		}
 		break;
 
 	case NBT_DICT:
 		for (;;) {
-			if ((res = stream->ReadU8(stream, &childType))) break;
+			if ((res = Nbt_ReadU8(reader, &childType))) break;
 			if (childType == NBT_END) break;
 
-			res = Nbt_ReadTag(childType, true, stream, &tag, callback, 0);
+			res = Nbt_ReadTag(childType, true, reader, &tag, callback, 0);
 			if (res) break;
 		}
 		break;
@@ -518,15 +588,20 @@ static BlockRaw* Nbt_TakeArray(struct NbtTag* tag, const char* type) {
 static cc_result Nbt_Read(struct Stream* stream, Nbt_Callback callback) {
 	struct Stream compStream;
 	struct InflateState state;
+	struct NbtReader reader;
 	cc_result res;
 	cc_uint8 tag;
 
 	Inflate_MakeStream2(&compStream, &state, stream);
 	if ((res = Map_SkipGZipHeader(stream))) return res;
-	if ((res = compStream.ReadU8(&compStream, &tag))) return res;
+
+	reader.source = &compStream;
+	reader.cur    = reader.buffer;
+	reader.left   = 0;
+	if ((res = Nbt_ReadU8(&reader, &tag))) return res;
 
 	if (tag != NBT_DICT) return CW_ERR_ROOT_TAG;
-	return Nbt_ReadTag(NBT_DICT, true, &compStream, NULL, callback, 0);
+	return Nbt_ReadTag(NBT_DICT, true, &reader, NULL, callback, 0);
 }
 
 
@@ -700,6 +775,19 @@ static PackedCol Cw_ParseColor(PackedCol defValue) {
 	return PackedCol_Make(r, g, b, 255);
 }
 
+/* Env is restored after benchmarking, so avoid raising events (which would e.g. rebuild the map) */
+static void Cw_SetSunCol(PackedCol color) {
+	if (!map_benchmarking) { Env_SetSunCol(color); return; }
+	PackedCol_GetShaded(color, &Env.SunXSide, &Env.SunZSide, &Env.SunYMin);
+	Env.SunCol = color;
+}
+
+static void Cw_SetShadowCol(PackedCol color) {
+	if (!map_benchmarking) { Env_SetShadowCol(color); return; }
+	PackedCol_GetShaded(color, &Env.ShadowXSide, &Env.ShadowZSide, &Env.ShadowYMin);
+	Env.ShadowCol = color;
+}
+
 static void Cw_Callback_4(struct NbtTag* tag) {
 	BlockID id = cw_curID;
 	struct LocalPlayer* p = &LocalPlayer_Instances[0];
@@ -721,7 +809,7 @@ static void Cw_Callback_4(struct NbtTag* tag) {
 
 		if (IsTag(tag, "TextureURL")) {
 			cc_string url = NbtTag_String(tag);
-			if (url.length) Server_RetrieveTexturePack(&url);
+			if (url.length && !map_benchmarking) Server_RetrieveTexturePack(&url);
 			return;
 		}
 	}
@@ -749,15 +837,15 @@ static void Cw_Callback_4(struct NbtTag* tag) {
 		} else if (IsTag(tag, "Fog")) {
 			Env.FogCol    = Cw_ParseColor(ENV_DEFAULT_FOG_COLOR); return;
 		} else if (IsTag(tag, "Sunlight")) {
-			Env_SetSunCol(Cw_ParseColor(ENV_DEFAULT_SUN_COLOR)); return;
+			Cw_SetSunCol(Cw_ParseColor(ENV_DEFAULT_SUN_COLOR)); return;
 		} else if (IsTag(tag, "Ambient")) {
-			Env_SetShadowCol(Cw_ParseColor(ENV_DEFAULT_SHADOW_COLOR)); return;
+			Cw_SetShadowCol(Cw_ParseColor(ENV_DEFAULT_SHADOW_COLOR)); return;
 		} else if (IsTag(tag, "Skybox")) {
 			Env.SkyboxCol = Cw_ParseColor(ENV_DEFAULT_SKYBOX_COLOR); return;
 		} 
 	}
 
-	if (IsTag(tag->parent, "BlockDefinitions") && Game_AllowCustomBlocks) {
+	if (IsTag(tag->parent, "BlockDefinitions") && Game_AllowCustomBlocks && !map_benchmarking) {
 		static const cc_string blockStr = String_FromConst("Block");
 		if (!String_CaselessStarts(&tag->name, &blockStr)) return;	
 
@@ -792,7 +880,7 @@ static void Cw_Callback_5(struct NbtTag* tag) {
 		if (IsTag(tag, "B")) { cw_colB = NbtTag_U16(tag); return; }
 	}
 
-	if (IsTag(tag->parent->parent, "BlockDefinitions") && Game_AllowCustomBlocks) {
+	if (IsTag(tag->parent->parent, "BlockDefinitions") && Game_AllowCustomBlocks && !map_benchmarking) {
 		if (IsTag(tag, "ID"))             { cw_curID = NbtTag_U8(tag);  return; }
 		if (IsTag(tag, "ID2"))            { cw_curID = NbtTag_U16(tag); return; }
 		if (IsTag(tag, "CollideType"))    { Blocks.Collide[id] = NbtTag_U8(tag); return; }
@@ -857,11 +945,7 @@ static void Cw_Callback_5(struct NbtTag* tag) {
 }
 
 static void Cw_Callback(struct NbtTag* tag) {
-	struct NbtTag* tmp = tag->parent;
-	int depth = 0;
-	while (tmp) { depth++; tmp = tmp->parent; }
-
-	switch (depth) {
+	switch (tag->depth) {
 	case 1: Cw_Callback_1(tag); return;
 	case 2: Cw_Callback_2(tag); return;
 	case 4: Cw_Callback_4(tag); return;
@@ -1459,11 +1543,7 @@ static void MCLevel_Callback_3(struct NbtTag* tag) {
 }
 
 static void MCLevel_Callback(struct NbtTag* tag) {
-	struct NbtTag* tmp = tag->parent;
-	int depth = 0;
-	while (tmp) { depth++; tmp = tmp->parent; }
-
-	switch (depth) {
+	switch (tag->depth) {
 	case 2: MCLevel_Callback_2(tag); return;
 	case 3: MCLevel_Callback_3(tag); return;
 	}
@@ -1570,7 +1650,8 @@ static cc_result Cw_WriteBockDef(struct Stream* stream, int b) {
 	return Stream_Write(stream, buffer, (int)(cur - buffer));
 }
 
-cc_result Cw_Save(struct Stream* stream) {
+/* Writes the ClassicWorld NBT data, optionally excluding the blocks of the world */
+static cc_result Cw_SaveWorld(struct Stream* stream, cc_bool withBlocks) {
 	struct LocalPlayer* p = Entities.CurPlayer;
 	cc_uint8 buffer[2048];
 	cc_uint8* cur;
@@ -1600,22 +1681,25 @@ cc_result Cw_Save(struct Stream* stream) {
 		cur  = Nbt_WriteUInt8(cur,  "H", Math_Deg2Packed(p->SpawnYaw));
 		cur  = Nbt_WriteUInt8(cur,  "P", Math_Deg2Packed(p->SpawnPitch));
 	} *cur++ = NBT_END;
-	cur = Nbt_WriteArray(cur, "BlockArray", World.Volume);
 
-	if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
-	if ((res = Stream_Write(stream, World.Blocks, World.Volume)))  return res;
+	if (withBlocks) {
+		cur = Nbt_WriteArray(cur, "BlockArray", World.Volume);
 
-#ifdef EXTENDED_BLOCKS
-	if (World.Blocks != World.Blocks2) {
+		if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
+		if ((res = Stream_Write(stream, World.Blocks, World.Volume)))  return res;
 		cur = buffer;
-		cur = Nbt_WriteArray(cur, "BlockArray2", World.Volume);
 
-		if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
-		if ((res = Stream_Write(stream, World.Blocks2, World.Volume))) return res;
-	}
+#ifdef EXTENDED_BLOCKS
+		if (World.Blocks != World.Blocks2) {
+			cur = Nbt_WriteArray(cur, "BlockArray2", World.Volume);
+
+			if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
+			if ((res = Stream_Write(stream, World.Blocks2, World.Volume))) return res;
+			cur = buffer;
+		}
 #endif
+	}
 
-	cur = buffer;
 	cur = Nbt_WriteDict(cur, "Metadata");
 	cur = Nbt_WriteDict(cur, "CPE");
 	{
@@ -1677,6 +1761,10 @@ cc_result Cw_Save(struct Stream* stream) {
 	return Stream_Write(stream, cw_end, sizeof(cw_end));
 }
 
+cc_result Cw_Save(struct Stream* stream) {
+	return Cw_SaveWorld(stream, true);
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------Schematic export------------------------------------------------------*
@@ -1856,6 +1944,479 @@ cc_result Dat_Save(struct Stream* stream) {
 }
 
 
+/*########################################################################################################################*
+*---------------------------------------------ClassiCube chunked map format-----------------------------------------------*
+*#########################################################################################################################*/
+/* Native map format designed for fast loading. Metadata is stored the same way as in ClassicWorld maps,
+     but blocks are split up into slices that are each compressed separately, so that the slices
+     can be decompressed on multiple threads at once.
+	U8[4] "Magic" ("CCMF")
+	U8    "Version" (1)
+	U8    "Flags" (see CCMAP_FLAG enum)
+	U16   "Width", "Height", "Length"
+	U32   "SlicesOffset" (offset of "SliceSizes" in file)
+	U8*   "Metadata" (GZIP compressed ClassicWorld NBT, without "BlockArray" or "BlockArray2")
+	U32*  "SliceSizes" (compressed size of each slice)
+	U8*   "Slices" (DEFLATE compressed blocks of each slice)
+
+	Each slice is one chunk high, and spans the entire width and length of the world.
+	 Blocks in each slice are stored in YZX order, so that each slice is contiguous in World.Blocks
+	 and can be decompressed directly into it. If CCMAP_FLAG_BLOCKS2 is set, the upper 8 bits
+	 of the blocks in the slice then follow.
+*/
+#define CCMAP_VERSION     1
+#define CCMAP_HEADER_SIZE 16
+enum CCMAP_FLAG { CCMAP_FLAG_BLOCKS2 = 0x01 };
+
+/* Not worth starting worker threads for small worlds */
+#define CCMAP_PARALLEL_MIN_VOLUME (1024 * 1024)
+#define CCMAP_WORKERS_COUNT 4
+
+static struct CcMapSlices {
+	BlockRaw* layers[2]; /* Lower and upper 8 bits of blocks */
+	int numLayers;       /* Number of block layers stored in each slice */
+	cc_uint8* data;      /* Compressed data of all the slices */
+	cc_uint32* offsets;  /* Offset of each slice in data (count + 1 offsets) */
+	int count, next;
+	cc_result result;
+	void* mutex;
+} ccmap;
+
+/* Decompresses the given slice directly into the world */
+static cc_result CcMap_DecodeSlice(int i, struct InflateState* inflate) {
+	struct Stream mem, compStream;
+	int y1     = i * CHUNK_SIZE;
+	int height = min(CHUNK_SIZE, World.Height - y1);
+	int layer;
+	BlockRaw* dst;
+	cc_result res;
+
+	Stream_ReadonlyMemory(&mem, ccmap.data + ccmap.offsets[i], ccmap.offsets[i + 1] - ccmap.offsets[i]);
+	Inflate_MakeStream2(&compStream, inflate, &mem);
+
+	for (layer = 0; layer < ccmap.numLayers; layer++)
+	{
+		/* Upper 8 bits are skipped over when extended blocks are unsupported */
+		dst = ccmap.layers[layer];
+		if (!dst) break;
+
+		res = Stream_Read(&compStream, dst + World_Pack(0, y1, 0), height * World.Width * World.Length);
+		if (res) return res;
+	}
+	return 0;
+}
+
+/* Returns index of the next slice to decompress, also recording the error from the last slice */
+static int CcMap_NextSlice(cc_result res) {
+	int i;
+	if (ccmap.mutex) Mutex_Lock(ccmap.mutex);
+
+	/* Stop decompressing any more slices once an error has occurred */
+	if (res && !ccmap.result) {
+		ccmap.result = res;
+		ccmap.next   = ccmap.count;
+	}
+	i = ccmap.next++;
+
+	if (ccmap.mutex) Mutex_Unlock(ccmap.mutex);
+	return i;
+}
+
+static void CcMapWorker_Run(void) {
+	struct InflateState* inflate;
+	cc_result res = 0;
+	int i;
+	inflate = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+
+	while ((i = CcMap_NextSlice(res)) < ccmap.count)
+	{
+		res = inflate ? CcMap_DecodeSlice(i, inflate) : ERR_OUT_OF_MEMORY;
+	}
+	Mem_Free(inflate);
+}
+
+/* Decompresses all the slices, using worker threads if possible */
+static cc_result CcMap_DecodeSlices(void) {
+#if defined CC_BUILD_COOPTHREADED || defined CC_BUILD_LOWMEM
+	CcMapWorker_Run();
+#else
+	void* threads[CCMAP_WORKERS_COUNT - 1];
+	int i, numThreads = 0;
+
+	if (ccmap.count > 1 && World.Volume >= CCMAP_PARALLEL_MIN_VOLUME) {
+		numThreads  = min(ccmap.count, CCMAP_WORKERS_COUNT) - 1;
+		ccmap.mutex = Mutex_Create("Map slices");
+	}
+
+	for (i = 0; i < numThreads; i++)
+	{
+		Thread_Run(&threads[i], CcMapWorker_Run, 64 * 1024, "Map worker");
+	}
+	/* This thread decompresses slices too, rather than just waiting around */
+	CcMapWorker_Run();
+
+	for (i = 0; i < numThreads; i++) { Thread_Join(threads[i]); }
+	if (ccmap.mutex) Mutex_Free(ccmap.mutex);
+	ccmap.mutex = NULL;
+#endif
+	return ccmap.result;
+}
+
+static cc_result CcMap_ReadSlices(struct Stream* stream, cc_uint8* sizes) {
+	cc_uint32 size, total = 0;
+	cc_result res;
+	int i;
+	if ((res = Stream_Read(stream, sizes, ccmap.count * 4))) return res;
+
+	for (i = 0; i < ccmap.count; i++)
+	{
+		ccmap.offsets[i] = total;
+		size   = Stream_GetU32_LE(&sizes[i * 4]);
+		total += size;
+		if (total < size) return CCMAP_ERR_SLICE_SIZE;
+	}
+	ccmap.offsets[ccmap.count] = total;
+
+	/* Source stream isn't thread safe, so read all the compressed data upfront */
+	ccmap.data = (cc_uint8*)Mem_TryAlloc(total + 1, 1);
+	if (!ccmap.data) return ERR_OUT_OF_MEMORY;
+	if ((res = Stream_Read(stream, ccmap.data, total))) return res;
+
+	return CcMap_DecodeSlices();
+}
+
+static cc_result CcMap_LoadBlocks(struct Stream* stream, cc_uint8* header) {
+	cc_uint64 volume;
+	cc_uint8* sizes;
+	cc_result res;
+
+	World.Width  = Stream_GetU16_LE(&header[6]);
+	World.Height = Stream_GetU16_LE(&header[8]);
+	World.Length = Stream_GetU16_LE(&header[10]);
+
+	/* 65535 x 65535 x 65535 would overflow World.Volume */
+	volume = (cc_uint64)World.Width * World.Height * World.Length;
+	if (!volume || volume > Int32_MaxValue) return CCMAP_ERR_DIMENSIONS;
+	World.Volume = (int)volume;
+
+	/* Metadata might have contained BlockArray/BlockArray2 tags too */
+#ifdef EXTENDED_BLOCKS
+	if (World.Blocks != World.Blocks2) Mem_Free(World.Blocks2);
+	World.Blocks2 = NULL;
+	World.IDMask  = 0xFF;
+#endif
+	Mem_Free(World.Blocks);
+	World.Blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+	if (!World.Blocks) return ERR_OUT_OF_MEMORY;
+
+	ccmap.layers[0] = World.Blocks;
+	ccmap.layers[1] = NULL;
+	ccmap.numLayers = (header[5] & CCMAP_FLAG_BLOCKS2) ? 2 : 1;
+
+#ifdef EXTENDED_BLOCKS
+	if (ccmap.numLayers == 2) {
+		ccmap.layers[1] = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+		if (!ccmap.layers[1]) return ERR_OUT_OF_MEMORY;
+		World_SetMapUpper(ccmap.layers[1]);
+	}
+#endif
+
+	ccmap.count  = Math_CeilDiv(World.Height, CHUNK_SIZE);
+	ccmap.next   = 0;
+	ccmap.result = 0;
+
+	ccmap.offsets = (cc_uint32*)Mem_TryAlloc(ccmap.count + 1, 4);
+	sizes         = (cc_uint8*)Mem_TryAlloc(ccmap.count, 4);
+
+	if (ccmap.offsets && sizes) {
+		res = CcMap_ReadSlices(stream, sizes);
+	} else {
+		res = ERR_OUT_OF_MEMORY;
+	}
+
+	Mem_Free(ccmap.offsets);
+	Mem_Free(ccmap.data);
+	Mem_Free(sizes);
+	ccmap.offsets = NULL;
+	ccmap.data    = NULL;
+	return res;
+}
+
+/* Imports a world from a .ccmap chunked map file */
+/* NOTE: stream must be seekable */
+static cc_result CcMap_Load(struct Stream* stream) {
+	cc_uint8 header[CCMAP_HEADER_SIZE];
+	cc_result res;
+
+	if ((res = Stream_Read(stream, header, sizeof(header)))) return res;
+	if (!Mem_Equal(header, "CCMF", 4)) return CCMAP_ERR_IDENTIFIER;
+	if (header[4] != CCMAP_VERSION)    return CCMAP_ERR_VERSION;
+
+	if ((res = Nbt_Read(stream, Cw_Callback))) return res;
+	/* Decompressing metadata might have read past the end of it */
+	if ((res = stream->Seek(stream, Stream_GetU32_LE(&header[12])))) return res;
+
+	return CcMap_LoadBlocks(stream, header);
+}
+
+static cc_result CcMap_WriteSlice(struct Stream* stream, struct DeflateState* state, int i) {
+	struct Stream compStream;
+	int y1     = i * CHUNK_SIZE;
+	int height = min(CHUNK_SIZE, World.Height - y1);
+	int layer;
+	cc_result res;
+
+	Deflate_MakeStream(&compStream, state, stream);
+
+	for (layer = 0; layer < ccmap.numLayers; layer++)
+	{
+		res = Stream_Write(&compStream, ccmap.layers[layer] + World_Pack(0, y1, 0), height * World.Width * World.Length);
+		if (res) return res;
+	}
+	return compStream.Close(&compStream);
+}
+
+static cc_result CcMap_SaveSlices(struct Stream* stream, struct GZipState* state, cc_uint8* sizes) {
+	cc_uint8 header[CCMAP_HEADER_SIZE] = { 'C','C','M','F', CCMAP_VERSION };
+	cc_uint32 slicesOffset, beg, end;
+	struct Stream compStream;
+	cc_result res;
+	int i;
+
+	header[5] = ccmap.numLayers == 2 ? CCMAP_FLAG_BLOCKS2 : 0;
+	Stream_SetU16_LE(&header[6],  World.Width);
+	Stream_SetU16_LE(&header[8],  World.Height);
+	Stream_SetU16_LE(&header[10], World.Length);
+	/* SlicesOffset is filled in afterwards */
+	if ((res = Stream_Write(stream, header, sizeof(header)))) return res;
+
+	GZip_MakeStream(&compStream, state, stream);
+	if ((res = Cw_SaveWorld(&compStream, false))) return res;
+	if ((res = compStream.Close(&compStream)))    return res;
+
+	/* Slice sizes are also filled in afterwards */
+	if ((res = stream->Position(stream, &slicesOffset)))       return res;
+	if ((res = Stream_Write(stream, sizes, ccmap.count * 4))) return res;
+	end = slicesOffset + ccmap.count * 4;
+
+	for (i = 0; i < ccmap.count; i++)
+	{
+		beg = end;
+		if ((res = CcMap_WriteSlice(stream, &state->Base, i))) return res;
+		if ((res = stream->Position(stream, &end))) return res;
+		Stream_SetU32_LE(&sizes[i * 4], end - beg);
+	}
+
+	Stream_SetU32_LE(&header[12], slicesOffset);
+	if ((res = stream->Seek(stream, 0)))                      return res;
+	if ((res = Stream_Write(stream, header, sizeof(header)))) return res;
+	if ((res = stream->Seek(stream, slicesOffset)))           return res;
+	return Stream_Write(stream, sizes, ccmap.count * 4);
+}
+
+cc_result CcMap_Save(struct Stream* stream) {
+	struct GZipState* state;
+	cc_uint8* sizes;
+	cc_result res;
+
+	ccmap.layers[0] = World.Blocks;
+	ccmap.numLayers = 1;
+#ifdef EXTENDED_BLOCKS
+	ccmap.layers[1] = World.Blocks2;
+	if (World.Blocks != World.Blocks2) ccmap.numLayers = 2;
+#endif
+	ccmap.count = Math_CeilDiv(World.Height, CHUNK_SIZE);
+
+	state = (struct GZipState*)Mem_TryAlloc(1, sizeof(struct GZipState));
+	sizes = (cc_uint8*)Mem_TryAllocCleared(ccmap.count, 4);
+
+	if (state && sizes) {
+		res = CcMap_SaveSlices(stream, state, sizes);
+	} else {
+		res = ERR_OUT_OF_MEMORY;
+	}
+
+	Mem_Free(state);
+	Mem_Free(sizes);
+	return res;
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------------Map benchmark----------------------------------------------------*
+*#########################################################################################################################*/
+/* Maps are saved into memory, so that file I/O doesn't affect the results */
+/* NOTE: meta.mem.length is the size of the saved data, meta.mem.left is the remaining capacity */
+static cc_result MapBench_Write(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	cc_uint32 position = (cc_uint32)(s->meta.mem.cur - s->meta.mem.base);
+	cc_uint32 capacity = position + s->meta.mem.left;
+	cc_uint8* base;
+
+	if (count > s->meta.mem.left) {
+		capacity = max(capacity * 2, position + count);
+		base     = (cc_uint8*)Mem_TryRealloc(s->meta.mem.base, capacity, 1);
+		if (!base) return ERR_OUT_OF_MEMORY;
+
+		s->meta.mem.base = base;
+		s->meta.mem.cur  = base + position;
+	}
+
+	Mem_Copy(s->meta.mem.cur, data, count);
+	s->meta.mem.cur   += count;
+	s->meta.mem.left   = capacity - (position + count);
+	s->meta.mem.length = max(s->meta.mem.length, position + count);
+
+	*modified = count; return 0;
+}
+
+static cc_result MapBench_Seek(struct Stream* s, cc_uint32 position) {
+	cc_uint32 capacity = (cc_uint32)(s->meta.mem.cur - s->meta.mem.base) + s->meta.mem.left;
+	if (position > s->meta.mem.length) return ERR_INVALID_ARGUMENT;
+
+	s->meta.mem.cur  = s->meta.mem.base + position;
+	s->meta.mem.left = capacity - position;
+	return 0;
+}
+
+static cc_result MapBench_Position(struct Stream* s, cc_uint32* position) {
+	*position = (cc_uint32)(s->meta.mem.cur - s->meta.mem.base); return 0;
+}
+
+static void MapBench_MakeStream(struct Stream* s) {
+	Stream_Init(s);
+	s->Write    = MapBench_Write;
+	s->Seek     = MapBench_Seek;
+	s->Position = MapBench_Position;
+
+	s->meta.mem.base   = NULL;
+	s->meta.mem.cur    = NULL;
+	s->meta.mem.left   = 0;
+	s->meta.mem.length = 0;
+}
+
+typedef cc_result (*MapExportFunc)(struct Stream* stream);
+static const struct MapBenchFormat {
+	const char* fileExt;
+	MapExportFunc save;
+	MapImportFunc load; /* NULL if format can't be loaded */
+	cc_bool gzip;       /* Whether save function's output must be GZIP compressed */
+} bench_formats[] = {
+	{ ".cw",        Cw_Save,        Cw_Load,    true  },
+	{ ".ccmap",     CcMap_Save,     CcMap_Load, false },
+	{ ".mine",      Dat_Save,       Dat_Load,   true  },
+	{ ".schematic", Schematic_Save, NULL,       true  }
+};
+
+/* Hashes the blocks and environment settings, which should be unchanged by saving then loading a map */
+static cc_uint32 MapBench_Hash(void) {
+	cc_uint32 hash = Utils_CRC32(World.Blocks, World.Volume);
+#ifdef EXTENDED_BLOCKS
+	if (World.Blocks != World.Blocks2) hash ^= Utils_CRC32(World.Blocks2, World.Volume) * 31;
+#endif
+	return hash ^ Utils_CRC32((const cc_uint8*)&Env, sizeof(Env));
+}
+
+static cc_result MapBench_Save(const struct MapBenchFormat* fmt, struct Stream* mem, struct GZipState* state) {
+	struct Stream compStream;
+	cc_result res;
+	if (!fmt->gzip) return fmt->save(mem);
+
+	GZip_MakeStream(&compStream, state, mem);
+	if ((res = fmt->save(&compStream))) return res;
+	return compStream.Close(&compStream);
+}
+
+/* Loads the saved map over the current world, then restores the current world afterwards */
+/* NOTE: Block definitions and texture pack in the map metadata are skipped, as they can't easily be */
+/*  restored afterwards. Env and reach distance are loaded as normal, then restored afterwards. */
+static cc_result MapBench_Load(const struct MapBenchFormat* fmt, struct Stream* mem, cc_uint32 hash, cc_bool* same) {
+	struct LocationUpdate update = { 0 };
+	struct _WorldData saved = World;
+	struct _EnvData savedEnv = Env;
+	float savedReach = LocalPlayer_Instances[0].ReachDistance;
+	struct Stream src;
+	cc_result res;
+
+	World.Blocks = NULL;
+#ifdef EXTENDED_BLOCKS
+	World.Blocks2 = NULL;
+	World.IDMask  = 0xFF;
+#endif
+	spawn_point      = &update;
+	map_benchmarking = true;
+
+	Stream_ReadonlyMemory(&src, mem->meta.mem.base, mem->meta.mem.length);
+	res = fmt->load(&src);
+	spawn_point      = NULL;
+	map_benchmarking = false;
+
+#ifdef EXTENDED_BLOCKS
+	if (!World.Blocks2) World.Blocks2 = World.Blocks;
+#endif
+	*same = !res && World.Blocks && World.Volume == saved.Volume && MapBench_Hash() == hash;
+
+#ifdef EXTENDED_BLOCKS
+	if (World.Blocks != World.Blocks2) Mem_Free(World.Blocks2);
+#endif
+	Mem_Free(World.Blocks);
+	World = saved;
+	Env   = savedEnv;
+	LocalPlayer_Instances[0].ReachDistance = savedReach;
+	return res;
+}
+
+static void MapBench_Run(const struct MapBenchFormat* fmt, struct GZipState* state) {
+	cc_string ext = String_FromReadonly(fmt->fileExt);
+	cc_uint32 hash = MapBench_Hash();
+	cc_uint64 beg, end;
+	struct Stream mem;
+	float saveMBs, loadMBs, sizeKB;
+	cc_bool same = false;
+	cc_result res;
+	MapBench_MakeStream(&mem);
+
+	beg = Stopwatch_Measure();
+	res = MapBench_Save(fmt, &mem, state);
+	end = Stopwatch_Measure();
+	if (res) { Chat_Add2("&e%s: &csaving failed with error %e", &ext, &res); goto cleanup; }
+
+	saveMBs = World.Volume / (float)max(1, Stopwatch_ElapsedMicroseconds(beg, end));
+	sizeKB  = mem.meta.mem.length / 1024.0f;
+
+	if (!fmt->load) {
+		Chat_Add3("&e%s: &fsaved at %f2 MB/s, %f1 KB", &ext, &saveMBs, &sizeKB);
+		goto cleanup;
+	}
+
+	beg = Stopwatch_Measure();
+	res = MapBench_Load(fmt, &mem, hash, &same);
+	end = Stopwatch_Measure();
+	if (res) { Chat_Add2("&e%s: &cloading failed with error %e", &ext, &res); goto cleanup; }
+
+	loadMBs = World.Volume / (float)max(1, Stopwatch_ElapsedMicroseconds(beg, end));
+	Chat_Add4("&e%s: &fsaved at %f2 MB/s, loaded at %f2 MB/s, %f1 KB", 
+				&ext, &saveMBs, &loadMBs, &sizeKB);
+	if (!same) Chat_Add1("&e%s: &cloaded world differs from saved world", &ext);
+
+cleanup:
+	Mem_Free(mem.meta.mem.base);
+}
+
+void Map_Benchmark(void) {
+	struct GZipState* state;
+	int i;
+
+	state = (struct GZipState*)Mem_TryAlloc(1, sizeof(struct GZipState));
+	if (!state) { Chat_AddRaw("&cNot enough memory to benchmark map formats"); return; }
+
+	for (i = 0; i < Array_Elems(bench_formats); i++)
+	{
+		MapBench_Run(&bench_formats[i], state);
+	}
+	Mem_Free(state);
+}
+
+
 /*########################################################################################################################*
 *-------------------------------------------------------Formats component-------------------------------------------------*
 *#########################################################################################################################*/
@@ -1865,6 +2426,7 @@ static struct MapImporter lvl_imp   = { ".lvl",     Lvl_Load };
 static struct MapImporter mine_imp  = { ".mine",    Dat_Load };
 static struct MapImporter fcm_imp   = { ".fcm",     Fcm_Load };
 static struct MapImporter mclvl_imp = { ".mclevel", MCLevel_Load };
+static struct MapImporter ccmap_imp = { ".ccmap",   CcMap_Load };
 
 static void OnInit(void) {
 	MapImporter_Register(&cw_imp);
@@ -1873,6 +2435,7 @@ static void OnInit(void) {
 	MapImporter_Register(&mine_imp);
 	MapImporter_Register(&fcm_imp);
 	MapImporter_Register(&mclvl_imp);
+	MapImporter_Register(&ccmap_imp);
 }
 
 static void OnFree(void) {
@@ -1886,6 +2449,8 @@ cc_result Map_LoadFrom(const cc_string* path) { return ERR_NOT_SUPPORTED; }
 cc_result Cw_Save(struct Stream* stream)  { return ERR_NOT_SUPPORTED; }
 cc_result Dat_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
 cc_result Schematic_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
+cc_result CcMap_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
+void Map_Benchmark(void) { }
 
 static void OnInit(void) { }
 static void OnFree(void) { }
@@ -38,6 +38,13 @@ cc_result Schematic_Save(struct Stream* stream);
 /* Exports a world to a .dat Classic map file */
 /* Used by MineCraft Classic */
 cc_result Dat_Save(struct Stream* stream);
+/* Exports a world to a .ccmap chunked map file, which loads faster than .cw files */
+/* NOTE: Unlike other formats, stream must be seekable and NOT be GZIP compressed */
+cc_result CcMap_Save(struct Stream* stream);
+
+/* Saves the current world to memory in each map format, then loads it back */
+/* Prints the save/load speed and size of each format, and whether the world was unchanged */
+void Map_Benchmark(void);
 
 CC_END_HEADER
 #endif
@@ -196,14 +196,22 @@ void Game_Reset(void) {
 	}
 }
 
-void Game_UpdateBlock(int x, int y, int z, BlockID block) {
+cc_bool Game_UpdateBlockState(int x, int y, int z, BlockID block) {
 	BlockID old = World_GetBlock(x, y, z);
+	/* Servers often resend blocks that are already set, which would otherwise */
+	/*  still cause lighting to be rechecked and chunks to be rebuilt */
+	if (old == block) return false;
 	World_SetBlock(x, y, z, block);
 
 	if (Weather_Heightmap) {
 		EnvRenderer_OnBlockChanged(x, y, z, old, block);
 	}
 	Lighting.OnBlockChanged(x, y, z, old, block);
+	return true;
+}
+
+void Game_UpdateBlock(int x, int y, int z, BlockID block) {
+	if (!Game_UpdateBlockState(x, y, z, block)) return;
 	MapRenderer_OnBlockChanged(x, y, z, block);
 }
 
@@ -103,6 +103,10 @@ void Game_Reset(void);
 /* (updating state means recalculating light, redrawing chunk block is in, etc) */
 /* NOTE: This does NOT notify the server, use Game_ChangeBlock for that. */
 CC_API void Game_UpdateBlock(int x, int y, int z, BlockID block);
+/* Same as Game_UpdateBlock, except that the chunk the block is in is not redrawn. */
+/* Returns whether the block was actually changed. Used when changing many blocks at once, */
+/*  with MapRenderer_RefreshRegion then called afterwards to redraw all the affected chunks. */
+cc_bool Game_UpdateBlockState(int x, int y, int z, BlockID block);
 /* Calls Game_UpdateBlock, then informs server connection of the block change. */
 /* In multiplayer this is sent to the server, in singleplayer just activates physics. */
 CC_API void Game_ChangeBlock(int x, int y, int z, BlockID block);
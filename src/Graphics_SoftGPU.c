@@ -20,9 +20,22 @@ static cc_bool depthTest  = true;
 static cc_bool depthWrite = true;
 static int db_stride;
 
+// Coarse depth buffer, storing an upper bound of the furthest depth in each 8x8 block of the depth buffer
+#define HIZ_SHIFT 3
+#define HIZ_SIZE  (1 << HIZ_SHIFT)
+static float* hizBuffer;
+static cc_uint8* hizStale; // Whether block's upper bound might be further than the actual furthest depth
+static int hiz_width, hiz_height;
+
 static void* gfx_vertices;
 static GfxResourceID white_square;
 
+static void FlushTriangles(void);
+static void StartRastWorkers(void);
+static void StopRastWorkers(void);
+static void AllocTileBins(void);
+static void FreeTileBins(void);
+
 void Gfx_RestoreState(void) {
 	InitDefaultResources();
 
@@ -31,6 +44,7 @@ void Gfx_RestoreState(void) {
 	BitmapCol pixels[1] = { BITMAPCOLOR_WHITE };
 	Bitmap_Init(bmp, 1, 1, pixels);
 	white_square = Gfx_CreateTexture(&bmp, 0, false);
+	Gfx_BindTexture(white_square);
 }
 
 void Gfx_FreeState(void) {
@@ -45,69 +59,157 @@ void Gfx_Create(void) {
 	Gfx.BackendType  = CC_GFX_BACKEND_SOFTGPU;
 	
 	Gfx_RestoreState();
+	StartRastWorkers();
 }
 
 static void DestroyBuffers(void) {
+	FlushTriangles();
+	FreeTileBins();
 	Window_FreeFramebuffer(&fb_bmp);
 	Mem_Free(depthBuffer);
+	Mem_Free(hizBuffer);
+	Mem_Free(hizStale);
+
 	depthBuffer = NULL;
+	hizBuffer   = NULL;
+	hizStale    = NULL;
 }
 
 void Gfx_Free(void) { 
 	Gfx_FreeState();
 	DestroyBuffers();
+	StopRastWorkers();
 }
 
 
+// Texels are stored in 4x4 blocks rather than in rows, so that texels which are near each other
+//  in any direction (e.g. when a texture is sampled sideways or at a distance) are usually in the same cache line
+static CC_INLINE int TexelIndex(int x, int y, int rowShift) {
+	return ((y >> 2) << rowShift) | ((x >> 2) << 4) | ((y & 3) << 2) | (x & 3);
+}
+
+// Width and height are padded to 4 texels, so a level always consists of whole 4x4 blocks
+#define TexLevel_Size(width, height) (max(width, 4) * max(height, 4))
+
+typedef struct CCTexLevel_ {
+	BitmapCol* pixels;
+	int width, height;
+	int rowShift; // log2 of the number of texels in each row of 4x4 blocks
+} CCTexLevel;
+
+// Base level and up to 12 mipmap levels for a 4096x4096 texture
+#define MAX_TEX_LEVELS 13
+
 typedef struct CCTexture {
 	int width, height;
+	int levels; // Number of mipmap levels after the base level
+	CCTexLevel mips[MAX_TEX_LEVELS];
 	BitmapCol pixels[];
 } CCTexture;
 
 static CCTexture* curTexture;
-static BitmapCol* curTexPixels;
 static int curTexWidth, curTexHeight;
-static int texWidthMask, texHeightMask;
+static cc_bool texMipmaps;
 		
 void Gfx_BindTexture(GfxResourceID texId) {
 	if (!texId) texId = white_square;
 	CCTexture* tex = texId;
 
 	curTexture   = tex;
-	curTexPixels = tex->pixels;
+	if (!tex) return; // white_square might have been deleted already
 	curTexWidth  = tex->width;
 	curTexHeight = tex->height;
-
-	texWidthMask  = (1 << Math_ilog2(tex->width))  - 1;
-	texHeightMask = (1 << Math_ilog2(tex->height)) - 1;
 }
 		
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	GfxResourceID data = *texId;
+	// Binned triangles might still be using this texture
+	if (data) FlushTriangles();
 	if (data) Mem_Free(data);
 	*texId = NULL;
+
+	// Don't leave the bound texture pointing at freed memory
+	if (data && data == curTexture) {
+		curTexture = NULL;
+		if (data != white_square) Gfx_BindTexture(white_square);
+	}
 }
 		
+static void SwizzleTexels(CCTexLevel* lvl, int x, int y, BitmapCol* src, int width, int height, int rowWidth) {
+	int xx, yy;
+	for (yy = 0; yy < height; yy++)
+	{
+		for (xx = 0; xx < width; xx++) 
+		{
+			lvl->pixels[TexelIndex(x + xx, y + yy, lvl->rowShift)] = src[xx];
+		}
+		src += rowWidth;
+	}
+}
+
+static void SoftGPU_DoMipmaps(CCTexture* tex, int x, int y, struct Bitmap* bmp, int rowWidth) {
+	BitmapCol* prev = bmp->scan0;
+	BitmapCol* cur;
+
+	int lvl, width = bmp->width, height = bmp->height;
+
+	for (lvl = 1; lvl <= tex->levels; lvl++) {
+		x /= 2; y /= 2;
+		width /= 2; height /= 2;
+		// Updated region might be too small to affect smaller mipmap levels
+		if (!width || !height) break;
+
+		cur = (BitmapCol*)Mem_Alloc(width * height, BITMAPCOLOR_SIZE, "mipmaps");
+		GenMipmaps(width, height, cur, prev, rowWidth);
+		SwizzleTexels(&tex->mips[lvl], x, y, cur, width, height, width);
+
+		if (prev != bmp->scan0) Mem_Free(prev);
+		prev     = cur;
+		rowWidth = width;
+	}
+	if (prev != bmp->scan0) Mem_Free(prev);
+}
+
 static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8 flags, cc_bool mipmaps) {
-	CCTexture* tex = (CCTexture*)Mem_Alloc(2 + bmp->width * bmp->height, 4, "Texture");
+	int width = bmp->width, height = bmp->height;
+	int i, levels = 0, size = 0;
+	CCTexture* tex;
+	BitmapCol* pixels;
 
-	tex->width  = bmp->width;
-	tex->height = bmp->height;
-	CopyTextureData(tex->pixels, bmp->width * BITMAPCOLOR_SIZE,
-					bmp, rowWidth * BITMAPCOLOR_SIZE);
+	// Both width and height are halved at each mipmap level, so stop once either reaches 1
+	if (mipmaps) levels = min(CalcMipmapsLevels(width, height), min(Math_ilog2(width), Math_ilog2(height)));
+	for (i = 0; i <= levels; i++) { size += TexLevel_Size(width >> i, height >> i); }
+
+	tex = (CCTexture*)Mem_Alloc(1, sizeof(CCTexture) + size * BITMAPCOLOR_SIZE, "Texture");
+	tex->width  = width;
+	tex->height = height;
+	tex->levels = levels;
+
+	for (i = 0, pixels = tex->pixels; i <= levels; i++) 
+	{
+		CCTexLevel* lvl = &tex->mips[i];
+		lvl->pixels   = pixels;
+		lvl->width    = width  >> i;
+		lvl->height   = height >> i;
+		lvl->rowShift = Math_ilog2(max(lvl->width, 4)) + 2;
+		pixels += TexLevel_Size(lvl->width, lvl->height);
+	}
+
+	SwizzleTexels(&tex->mips[0], 0, 0, bmp->scan0, width, height, rowWidth);
+	if (levels) SoftGPU_DoMipmaps(tex, 0, 0, bmp, rowWidth);
 	return tex;
 }
 
 void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps) {
 	CCTexture* tex = (CCTexture*)texId;
-	BitmapCol* dst = (tex->pixels + x) + y * tex->width;
+	FlushTriangles();
 
-	CopyTextureData(dst, tex->width * BITMAPCOLOR_SIZE,
-					part, rowWidth  * BITMAPCOLOR_SIZE);
+	SwizzleTexels(&tex->mips[0], x, y, part->scan0, part->width, part->height, rowWidth);
+	if (mipmaps && tex->levels) SoftGPU_DoMipmaps(tex, x, y, part, rowWidth);
 }
 
-void Gfx_EnableMipmaps(void)  { }
-void Gfx_DisableMipmaps(void) { }
+void Gfx_EnableMipmaps(void)  { texMipmaps = true;  }
+void Gfx_DisableMipmaps(void) { texMipmaps = false; }
 
 
 /*########################################################################################################################*
@@ -152,9 +254,14 @@ static void ClearColorBuffer(void) {
 static void ClearDepthBuffer(void) {
 	int i, size = fb_width * fb_height;
 	for (i = 0; i < size; i++) depthBuffer[i] = 100000000.0f;
+
+	size = hiz_width * hiz_height;
+	for (i = 0; i < size; i++) hizBuffer[i] = 100000000.0f;
+	Mem_Set(hizStale, 0, size);
 }
 
 void Gfx_ClearBuffers(GfxBuffers buffers) {
+	FlushTriangles();
 	if (buffers & GFX_BUFFER_COLOR) ClearColorBuffer();
 	if (buffers & GFX_BUFFER_DEPTH) ClearDepthBuffer();
 }
@@ -376,7 +483,44 @@ static CC_INLINE int FastFloor(float value) {
 
 #define edgeFunction(ax,ay, bx,by, cx,cy) (((bx) - (ax)) * ((cy) - (ay)) - ((by) - (ay)) * ((cx) - (ax)))
 
-static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+#define TRI_3D          0x01
+#define TRI_TEXTURED    0x02
+#define TRI_ALPHA_TEST  0x04
+#define TRI_ALPHA_BLEND 0x08
+#define TRI_DEPTH_TEST  0x10
+#define TRI_DEPTH_WRITE 0x20
+#define TRI_COLOR_WRITE 0x40
+
+// A triangle that has been set up for rasterization
+// Also stores the render state it was drawn with, since it may be rasterized later on
+typedef struct Triangle_ {
+	int x0, y0, x1, y1, x2, y2;
+	int minX, minY, maxX, maxY;
+	float factor;
+	float minZ, maxZ; // Conservative range of depth values across the triangle
+	float z0, z1, z2;
+	float w0, w1, w2;
+	float u0, u1, u2;
+	float v0, v1, v2;
+	PackedCol color;
+	BitmapCol* texPixels;
+	int texWidth, texHeight;
+	int texWidthMask, texHeightMask;
+	int texRowShift;
+	int flags;
+} Triangle;
+
+static void SetupTexture(Triangle* t, const CCTexLevel* lvl) {
+	t->texPixels     = lvl->pixels;
+	t->texWidth      = lvl->width;
+	t->texHeight     = lvl->height;
+	t->texWidthMask  = lvl->width  - 1;
+	t->texHeightMask = lvl->height - 1;
+	t->texRowShift   = lvl->rowShift;
+}
+
+// Returns false if the triangle is entirely outside the framebuffer/scissor region
+static cc_bool SetupBounds(Triangle* t, Vertex* V0, Vertex* V1, Vertex* V2) {
 	int x0 = (int)V0->x, y0 = (int)V0->y;
 	int x1 = (int)V1->x, y1 = (int)V1->y;
 	int x2 = (int)V2->x, y2 = (int)V2->y;
@@ -385,19 +529,116 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	int maxX = max(x0, max(x1, x2));
 	int maxY = max(y0, max(y1, y2));
 
-	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
 	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
+	if (maxX < 0 || minX > fb_maxX) return false;
+	if (maxY < 0 || minY > fb_maxY) return false;
 
 	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
-	float factor = 1.0f / area;
+	t->minX = max(minX, 0); t->maxX = min(maxX, fb_maxX);
+	t->minY = max(minY, 0); t->maxY = min(maxY, fb_maxY);
+
+	t->x0 = x0; t->y0 = y0;
+	t->x1 = x1; t->y1 = y1;
+	t->x2 = x2; t->y2 = y2;
+	t->color = V0->c;
+
+	t->flags = 0;
+	// curTexture is only NULL after white_square has been deleted
+	if (gfx_format == VERTEX_FORMAT_TEXTURED && curTexture) {
+		t->flags |= TRI_TEXTURED;
+		SetupTexture(t, &curTexture->mips[0]);
+	}
+	if (gfx_alphaTest)  t->flags |= TRI_ALPHA_TEST;
+	if (gfx_alphaBlend) t->flags |= TRI_ALPHA_BLEND;
+	return true;
+}
 
-	float u0 = V0->u * curTexWidth,  u1 = V1->u * curTexWidth,  u2 = V2->u * curTexWidth;
-	float v0 = V0->v * curTexHeight, v1 = V1->v * curTexHeight, v2 = V2->v * curTexHeight;
-	PackedCol color = V0->c;
+static cc_bool SetupTriangle2D(Triangle* t, Vertex* V0, Vertex* V1, Vertex* V2) {
+	if (!SetupBounds(t, V0, V1, V2)) return false;
+	int area  = edgeFunction(t->x0,t->y0, t->x1,t->y1, t->x2,t->y2);
+	if (!area) return false; // degenerate triangles don't cover any pixels
+	t->factor = 1.0f / area;
+
+	t->u0 = V0->u * curTexWidth;  t->u1 = V1->u * curTexWidth;  t->u2 = V2->u * curTexWidth;
+	t->v0 = V0->v * curTexHeight; t->v1 = V1->v * curTexHeight; t->v2 = V2->v * curTexHeight;
+	return true;
+}
+
+// Picks the mipmap level that's closest to one texel per pixel across the triangle
+static int SelectMipmapLevel(Vertex* V0, Vertex* V1, Vertex* V2, int area) {
+	// NOTE: UV in vertices has already been divided by W
+	float du1 = (V1->u / V1->w - V0->u / V0->w) * curTexWidth;
+	float dv1 = (V1->v / V1->w - V0->v / V0->w) * curTexHeight;
+	float du2 = (V2->u / V2->w - V0->u / V0->w) * curTexWidth;
+	float dv2 = (V2->v / V2->w - V0->v / V0->w) * curTexHeight;
+	float texelsPerPixel = Math_AbsF(du1 * dv2 - du2 * dv1) / Math_AbsF((float)area);
+
+	// Due to perspective, the nearest part of the triangle has fewer texels per pixel than average
+	// So scale by the worst case difference, as otherwise nearby parts would look blurry
+	// (scale is the ratio along each axis, and texelsPerPixel is a ratio of areas)
+	float nearW = max(V0->w, max(V1->w, V2->w));
+	float farW  = min(V0->w, min(V1->w, V2->w));
+	float scale = farW / nearW;
+	texelsPerPixel *= scale * scale;
+
+	// Each mipmap level has 4 times fewer texels than the previous level
+	int level = 0;
+	while (texelsPerPixel >= 4.0f && level < curTexture->levels)
+	{
+		texelsPerPixel *= 0.25f; level++;
+	}
+	return level;
+}
+
+static cc_bool SetupTriangle3D(Triangle* t, Vertex* V0, Vertex* V1, Vertex* V2) {
+	if (faceCulling) {
+		int x0 = (int)V0->x, y0 = (int)V0->y;
+		int x1 = (int)V1->x, y1 = (int)V1->y;
+		int x2 = (int)V2->x, y2 = (int)V2->y;
+		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
+		if (edgeFunction(x0,y0, x1,y1, x2,y2) < 0) return false;
+	}
+	// TODO proper clipping
+	if (V0->w <= 0 || V1->w <= 0 || V2->w <= 0) return false;
+	if (!SetupBounds(t, V0, V1, V2)) return false;
+
+	int area  = edgeFunction(t->x0,t->y0, t->x1,t->y1, t->x2,t->y2);
+	if (!area) return false; // degenerate triangles don't cover any pixels
+	t->factor = 1.0f / area;
+	t->flags |= TRI_3D;
+	if (depthTest)  t->flags |= TRI_DEPTH_TEST;
+	if (depthWrite) t->flags |= TRI_DEPTH_WRITE;
+	if (colWrite)   t->flags |= TRI_COLOR_WRITE;
+
+	if (texMipmaps && (t->flags & TRI_TEXTURED) && curTexture->levels) {
+		SetupTexture(t, &curTexture->mips[SelectMipmapLevel(V0, V1, V2, area)]);
+	}
+
+	// NOTE: W in frag variables below is actually 1/W 
+	t->w0 = V0->w; t->w1 = V1->w; t->w2 = V2->w;
+	t->z0 = V0->z; t->z1 = V1->z; t->z2 = V2->z;
+	t->u0 = V0->u; t->u1 = V1->u; t->u2 = V2->u;
+	t->v0 = V0->v; t->v1 = V1->v; t->v2 = V2->v;
+
+	// Interpolated depth is a weighted average of each vertex's Z/W, so always lies between the smallest and largest
+	// Widen the range a little though, as the depth calculated per pixel has rounding error
+	float d0 = V0->z / V0->w, d1 = V1->z / V1->w, d2 = V2->z / V2->w;
+	float minZ = min(d0, min(d1, d2));
+	float maxZ = max(d0, max(d1, d2));
+	t->minZ = minZ - Math_AbsF(minZ) * 0.001f;
+	t->maxZ = maxZ + Math_AbsF(maxZ) * 0.001f;
+	return true;
+}
+
+static void RasterTriangle2D(const Triangle* t, int minX, int minY, int maxX, int maxY) {
+	int x0 = t->x0, y0 = t->y0;
+	int x1 = t->x1, y1 = t->y1;
+	int x2 = t->x2, y2 = t->y2;
+	float factor = t->factor;
+
+	float u0 = t->u0, u1 = t->u1, u2 = t->u2;
+	float v0 = t->v0, v1 = t->v1, v2 = t->v2;
+	PackedCol color = t->color;
 	
 	// https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
 	// Essentially these are the deltas of edge functions between X/Y and X/Y + 1 (i.e. one X/Y step)
@@ -425,14 +666,14 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 			int cb_index = y * cb_stride + x;
 
 			int R, G, B, A;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+			if (t->flags & TRI_TEXTURED) {
 				float u = ic0 * u0 + ic1 * u1 + ic2 * u2;
 				float v = ic0 * v0 + ic1 * v1 + ic2 * v2;
-				int texX = ((int)u) & texWidthMask;
-				int texY = ((int)v) & texHeightMask;
-				int texIndex = texY * curTexWidth + texX;
+				int texX = ((int)u) & t->texWidthMask;
+				int texY = ((int)v) & t->texHeightMask;
+				int texIndex = TexelIndex(texX, texY, t->texRowShift);
 
-				BitmapCol tColor = curTexPixels[texIndex];
+				BitmapCol tColor = t->texPixels[texIndex];
 				int a1 = PackedCol_A(color), a2 = BitmapCol_A(tColor);
 				A = ( a1 * a2 ) >> 8;
 				int r1 = PackedCol_R(color), r2 = BitmapCol_R(tColor);
@@ -448,8 +689,8 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 				A = PackedCol_A(color);
 			}
 
-			if (gfx_alphaTest && A < 0x80) continue;
-			if (gfx_alphaBlend) {
+			if ((t->flags & TRI_ALPHA_TEST) && A < 0x80) continue;
+			if (t->flags & TRI_ALPHA_BLEND) {
 				BitmapCol dst = colorBuffer[cb_index];
 				int dstR = BitmapCol_R(dst);
 				int dstG = BitmapCol_G(dst);
@@ -465,42 +706,378 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	}
 }
 
-static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
-	int x0 = (int)V0->x, y0 = (int)V0->y;
-	int x1 = (int)V1->x, y1 = (int)V1->y;
-	int x2 = (int)V2->x, y2 = (int)V2->y;
-	int minX = min(x0, min(x1, x2));
-	int minY = min(y0, min(y1, y2));
-	int maxX = max(x0, max(x1, x2));
-	int maxY = max(y0, max(y1, y2));
+// Rasterizes 3D triangles 4 pixels at a time, using SSE2 or NEON when the compiler supports it
+// The ops below are written so that both give exactly the same results as the scalar rasterizer
+#if defined BITMAP_16BPP
+	// 16 bit colours aren't worth vectorising
+#elif defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTGPU_SIMD
+typedef __m128  Vec4f;
+typedef __m128i Vec4i; // Also used for lane masks and 4 packed colours
+
+#define Vec4f_Set1(value)     _mm_set1_ps(value)
+#define Vec4f_Load(ptr)       _mm_loadu_ps(ptr)
+#define Vec4f_Store(ptr, v)   _mm_storeu_ps(ptr, v)
+#define Vec4f_Add(a, b)       _mm_add_ps(a, b)
+#define Vec4f_Sub(a, b)       _mm_sub_ps(a, b)
+#define Vec4f_Mul(a, b)       _mm_mul_ps(a, b)
+#define Vec4f_Div(a, b)       _mm_div_ps(a, b)
+#define Vec4f_Abs(a)          _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)))
+#define Vec4f_Less(a, b)      _mm_castps_si128(_mm_cmplt_ps(a, b))
+#define Vec4f_Greater(a, b)   _mm_castps_si128(_mm_cmpgt_ps(a, b))
+#define Vec4f_Select(m, a, b) _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(m), a), _mm_andnot_ps(_mm_castsi128_ps(m), b))
+#define Vec4f_FromInt(a)      _mm_cvtepi32_ps(a)
+#define Vec4f_ToInt(a)        _mm_cvttps_epi32(a)
+
+#define Vec4i_Set1(value)     _mm_set1_epi32(value)
+#define Vec4i_Load(ptr)       _mm_loadu_si128((const __m128i*)(ptr))
+#define Vec4i_Store(ptr, v)   _mm_storeu_si128((__m128i*)(ptr), v)
+#define Vec4i_And(a, b)       _mm_and_si128(a, b)
+#define Vec4i_Or(a, b)        _mm_or_si128(a, b)
+#define Vec4i_ShiftL(a, bits) _mm_slli_epi32(a, bits)
+#define Vec4i_ShiftR(a, bits) _mm_srli_epi32(a, bits)
+#define Vec4i_Less(a, b)      _mm_cmplt_epi32(a, b)
+#define Vec4i_Select(m, a, b) _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define Vec4i_AllSet(m)       (_mm_movemask_epi8(m) == 0xFFFF)
+
+// Multiplies each 8 bit channel, i.e. (a * b) >> 8
+static CC_INLINE Vec4i Vec4i_MulBytes(Vec4i a, Vec4i b) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo   = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+	__m128i hi   = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+	return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
 
-	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
-	if (faceCulling) {
-		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
-		if (area < 0) return;
-	}
+// Blends each 8 bit channel, i.e. (src * alpha + dst * (255 - alpha)) >> 8
+static CC_INLINE Vec4i Vec4i_BlendBytes(Vec4i src, Vec4i dst, Vec4i alpha) {
+	__m128i zero  = _mm_setzero_si128();
+	__m128i inv   = _mm_andnot_si128(alpha, _mm_set1_epi8(-1));
+	__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(alpha, zero)),
+							   _mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(inv,   zero)));
+	__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(alpha, zero)),
+							   _mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(inv,   zero)));
+	return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+#elif defined __aarch64__ && defined __ARM_NEON
+#include <arm_neon.h>
+#define SOFTGPU_SIMD
+typedef float32x4_t Vec4f;
+typedef uint32x4_t  Vec4i; // Also used for lane masks and 4 packed colours
+
+#define Vec4f_Set1(value)     vdupq_n_f32(value)
+#define Vec4f_Load(ptr)       vld1q_f32(ptr)
+#define Vec4f_Store(ptr, v)   vst1q_f32(ptr, v)
+#define Vec4f_Add(a, b)       vaddq_f32(a, b)
+#define Vec4f_Sub(a, b)       vsubq_f32(a, b)
+#define Vec4f_Mul(a, b)       vmulq_f32(a, b)
+#define Vec4f_Div(a, b)       vdivq_f32(a, b)
+#define Vec4f_Abs(a)          vabsq_f32(a)
+#define Vec4f_Less(a, b)      vcltq_f32(a, b)
+#define Vec4f_Greater(a, b)   vcgtq_f32(a, b)
+#define Vec4f_Select(m, a, b) vbslq_f32(m, a, b)
+#define Vec4f_FromInt(a)      vcvtq_f32_s32(vreinterpretq_s32_u32(a))
+#define Vec4f_ToInt(a)        vreinterpretq_u32_s32(vcvtq_s32_f32(a))
+
+#define Vec4i_Set1(value)     vdupq_n_u32(value)
+#define Vec4i_Load(ptr)       vld1q_u32((const cc_uint32*)(ptr))
+#define Vec4i_Store(ptr, v)   vst1q_u32((cc_uint32*)(ptr), v)
+#define Vec4i_And(a, b)       vandq_u32(a, b)
+#define Vec4i_Or(a, b)        vorrq_u32(a, b)
+#define Vec4i_ShiftL(a, bits) vshlq_n_u32(a, bits)
+#define Vec4i_ShiftR(a, bits) vshrq_n_u32(a, bits)
+#define Vec4i_Less(a, b)      vcltq_s32(vreinterpretq_s32_u32(a), vreinterpretq_s32_u32(b))
+#define Vec4i_Select(m, a, b) vbslq_u32(m, a, b)
+#define Vec4i_AllSet(m)       (vminvq_u32(m) == 0xFFFFFFFF)
+
+// Multiplies each 8 bit channel, i.e. (a * b) >> 8
+static CC_INLINE Vec4i Vec4i_MulBytes(Vec4i a, Vec4i b) {
+	uint8x16_t a8 = vreinterpretq_u8_u32(a), b8 = vreinterpretq_u8_u32(b);
+	uint16x8_t lo = vmull_u8(vget_low_u8(a8), vget_low_u8(b8));
+	uint16x8_t hi = vmull_high_u8(a8, b8);
+	return vreinterpretq_u32_u8(vshrn_high_n_u16(vshrn_n_u16(lo, 8), hi, 8));
+}
 
-	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
+// Blends each 8 bit channel, i.e. (src * alpha + dst * (255 - alpha)) >> 8
+static CC_INLINE Vec4i Vec4i_BlendBytes(Vec4i src, Vec4i dst, Vec4i alpha) {
+	uint8x16_t s8 = vreinterpretq_u8_u32(src), d8 = vreinterpretq_u8_u32(dst);
+	uint8x16_t a8 = vreinterpretq_u8_u32(alpha), i8 = vmvnq_u8(a8);
+	uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(s8), vget_low_u8(a8)), vget_low_u8(d8), vget_low_u8(i8));
+	uint16x8_t hi = vmlal_high_u8(vmull_high_u8(s8, a8), d8, i8);
+	return vreinterpretq_u32_u8(vshrn_high_n_u16(vshrn_n_u16(lo, 8), hi, 8));
+}
+#endif
 
-	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
+#ifdef SOFTGPU_SIMD
+static const float lane_offsets[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
 
-	// NOTE: W in frag variables below is actually 1/W 
-	float factor = 1.0f / area;
-	float w0 = V0->w, w1 = V1->w, w2 = V2->w;
-	
-	// TODO proper clipping
-	if (w0 <= 0 || w1 <= 0 || w2 <= 0) {
+// Equivalent to value - FastFloor(value)
+static CC_INLINE Vec4f Vec4f_Fract(Vec4f value) {
+	Vec4f trunc = Vec4f_FromInt(Vec4f_ToInt(value));
+	Vec4f floor = Vec4f_Select(Vec4f_Greater(trunc, value), Vec4f_Sub(trunc, Vec4f_Set1(1.0f)), trunc);
+	return Vec4f_Sub(value, floor);
+}
+
+// Triangle variables broadcast to all 4 lanes, calculated once per triangle rather than once per block
+struct RasterVec4 {
+	Vec4f factor;
+	Vec4f w0, w1, w2, z0, z1, z2;
+	Vec4f u0, u1, u2, v0, v1, v2;
+	Vec4f texWidth, texHeight;
+	Vec4i texWidthMask, texHeightMask;
+	Vec4i color;
+};
+
+static void SetupRasterVec4(struct RasterVec4* r, const Triangle* t) {
+	PackedCol c = t->color;
+	r->factor = Vec4f_Set1(t->factor);
+
+	r->w0 = Vec4f_Set1(t->w0); r->w1 = Vec4f_Set1(t->w1); r->w2 = Vec4f_Set1(t->w2);
+	r->z0 = Vec4f_Set1(t->z0); r->z1 = Vec4f_Set1(t->z1); r->z2 = Vec4f_Set1(t->z2);
+	r->u0 = Vec4f_Set1(t->u0); r->u1 = Vec4f_Set1(t->u1); r->u2 = Vec4f_Set1(t->u2);
+	r->v0 = Vec4f_Set1(t->v0); r->v1 = Vec4f_Set1(t->v1); r->v2 = Vec4f_Set1(t->v2);
+
+	r->texWidth      = Vec4f_Set1((float)t->texWidth);
+	r->texHeight     = Vec4f_Set1((float)t->texHeight);
+	r->texWidthMask  = Vec4i_Set1(t->texWidthMask);
+	r->texHeightMask = Vec4i_Set1(t->texHeightMask);
+	r->color = Vec4i_Set1(BitmapCol_Make(PackedCol_R(c), PackedCol_G(c), PackedCol_B(c), PackedCol_A(c)));
+}
+#endif
+
+static CC_INLINE void RasterPixel3D(const Triangle* t, int x, int y, float bc0, float bc1, float bc2) {
+	float ic0 = bc0 * t->factor;
+	float ic1 = bc1 * t->factor;
+	float ic2 = bc2 * t->factor;
+	if (ic0 < 0 || ic1 < 0 || ic2 < 0) return;
+	int db_index = y * db_stride + x;
+
+	float w = 1 / (ic0 * t->w0 + ic1 * t->w1 + ic2 * t->w2);
+	float z = (ic0 * t->z0 + ic1 * t->z1 + ic2 * t->z2) * w;
+
+	if ((t->flags & TRI_DEPTH_TEST) && (z < 0 || z > depthBuffer[db_index])) return;
+	if (!(t->flags & TRI_COLOR_WRITE)) {
+		if (t->flags & TRI_DEPTH_WRITE) depthBuffer[db_index] = z;
 		return;
 	}
 
-	float z0 = V0->z, z1 = V1->z, z2 = V2->z;
-	float u0 = V0->u, u1 = V1->u, u2 = V2->u;
-	float v0 = V0->v, v1 = V1->v, v2 = V2->v;
-	PackedCol color = V0->c;
+	int R, G, B, A;
+	if (t->flags & TRI_TEXTURED) {
+		float u = (ic0 * t->u0 + ic1 * t->u1 + ic2 * t->u2) * w;
+		float v = (ic0 * t->v0 + ic1 * t->v1 + ic2 * t->v2) * w;
+		int texX = ((int)(Math_AbsF(u - FastFloor(u)) * t->texWidth )) & t->texWidthMask;
+		int texY = ((int)(Math_AbsF(v - FastFloor(v)) * t->texHeight)) & t->texHeightMask;
+		int texIndex = TexelIndex(texX, texY, t->texRowShift);
+
+		BitmapCol tColor = t->texPixels[texIndex];
+		int a1 = PackedCol_A(t->color), a2 = BitmapCol_A(tColor);
+		A = ( a1 * a2 ) >> 8;
+		int r1 = PackedCol_R(t->color), r2 = BitmapCol_R(tColor);
+		R = ( r1 * r2 ) >> 8;
+		int g1 = PackedCol_G(t->color), g2 = BitmapCol_G(tColor);
+		G = ( g1 * g2 ) >> 8;
+		int b1 = PackedCol_B(t->color), b2 = BitmapCol_B(tColor);
+		B = ( b1 * b2 ) >> 8;
+	} else {
+		R = PackedCol_R(t->color);
+		G = PackedCol_G(t->color);
+		B = PackedCol_B(t->color);
+		A = PackedCol_A(t->color);
+	}
+
+	if ((t->flags & TRI_ALPHA_TEST) && A < 0x80) return;
+	int cb_index = y * cb_stride + x;
+	
+	if (t->flags & TRI_ALPHA_BLEND) {
+		BitmapCol dst = colorBuffer[cb_index];
+		int dstR = BitmapCol_R(dst);
+		int dstG = BitmapCol_G(dst);
+		int dstB = BitmapCol_B(dst);
+
+		R = (R * A + dstR * (255 - A)) >> 8;
+		G = (G * A + dstG * (255 - A)) >> 8;
+		B = (B * A + dstB * (255 - A)) >> 8;
+	}
+
+	if (t->flags & TRI_DEPTH_WRITE) depthBuffer[db_index] = z;
+	colorBuffer[cb_index] = BitmapCol_Make(R, G, B, 0xFF);
+}
+
+#ifdef SOFTGPU_SIMD
+// Rasterizes the given block 4 pixels at a time, with bc0/bc1/bc2 being the edge functions at its top left pixel
+// Each 4 pixels are aligned to a multiple of 4, with lanes outside the block being masked off
+static void RasterBlock3D(const Triangle* t, const struct RasterVec4* r, int minX, int minY, int maxX, int maxY,
+						float bc0, float bc1, float bc2) {
+	int dx01 = t->y0 - t->y1, dy01 = t->x1 - t->x0;
+	int dx12 = t->y1 - t->y2, dy12 = t->x2 - t->x1;
+	int dx20 = t->y2 - t->y0, dy20 = t->x0 - t->x2;
+	// 4 pixels must not run past the end of a framebuffer row, so any leftover columns are done one pixel at a time
+	int startX = minX & ~3, endX = fb_width & ~3;
+
+	Vec4f lanes = Vec4f_Load(lane_offsets);
+	Vec4f zero  = Vec4f_Set1(0.0f);
+	Vec4f one   = Vec4f_Set1(1.0f);
+
+	Vec4f row0  = Vec4f_Add(Vec4f_Set1(bc0), Vec4f_Mul(Vec4f_Sub(lanes, Vec4f_Set1((float)(minX - startX))), Vec4f_Set1((float)dx12)));
+	Vec4f row1  = Vec4f_Add(Vec4f_Set1(bc1), Vec4f_Mul(Vec4f_Sub(lanes, Vec4f_Set1((float)(minX - startX))), Vec4f_Set1((float)dx20)));
+	Vec4f row2  = Vec4f_Add(Vec4f_Set1(bc2), Vec4f_Mul(Vec4f_Sub(lanes, Vec4f_Set1((float)(minX - startX))), Vec4f_Set1((float)dx01)));
+	Vec4f stepX0 = Vec4f_Set1(dx12 * 4.0f), stepY0 = Vec4f_Set1((float)dy12);
+	Vec4f stepX1 = Vec4f_Set1(dx20 * 4.0f), stepY1 = Vec4f_Set1((float)dy20);
+	Vec4f stepX2 = Vec4f_Set1(dx01 * 4.0f), stepY2 = Vec4f_Set1((float)dy01);
+
+	Vec4i opaque   = Vec4i_Set1(BITMAPCOLOR_A_MASK);
+	Vec4i byteMask = Vec4i_Set1(0xFF);
+	Vec4i minAlpha = Vec4i_Set1(0x80);
+	int flags = t->flags;
+
+	for (int y = minY; y <= maxY; y++, row0 = Vec4f_Add(row0, stepY0), row1 = Vec4f_Add(row1, stepY1), row2 = Vec4f_Add(row2, stepY2))
+	{
+		Vec4f vbc0 = row0, vbc1 = row1, vbc2 = row2;
+		int x;
+
+		for (x = startX; x <= maxX && x < endX; x += 4, vbc0 = Vec4f_Add(vbc0, stepX0), vbc1 = Vec4f_Add(vbc1, stepX1), vbc2 = Vec4f_Add(vbc2, stepX2))
+		{
+			Vec4f ic0 = Vec4f_Mul(vbc0, r->factor);
+			Vec4f ic1 = Vec4f_Mul(vbc1, r->factor);
+			Vec4f ic2 = Vec4f_Mul(vbc2, r->factor);
+
+			// Lanes set in the mask are left unchanged
+			Vec4i skip = Vec4i_Or(Vec4i_Or(Vec4f_Less(ic0, zero), Vec4f_Less(ic1, zero)), Vec4f_Less(ic2, zero));
+			if (x < minX || x + 3 > maxX) {
+				skip = Vec4i_Or(skip, Vec4f_Less(lanes, Vec4f_Set1((float)(minX - x))));
+				skip = Vec4i_Or(skip, Vec4f_Greater(lanes, Vec4f_Set1((float)(maxX - x))));
+			}
+			if (Vec4i_AllSet(skip)) continue;
+
+			int db_index = y * db_stride + x;
+			int cb_index = y * cb_stride + x;
+			Vec4f depth  = Vec4f_Load(&depthBuffer[db_index]);
+
+			Vec4f w = Vec4f_Div(one, Vec4f_Add(Vec4f_Add(Vec4f_Mul(ic0, r->w0), Vec4f_Mul(ic1, r->w1)), Vec4f_Mul(ic2, r->w2)));
+			Vec4f z = Vec4f_Mul(Vec4f_Add(Vec4f_Add(Vec4f_Mul(ic0, r->z0), Vec4f_Mul(ic1, r->z1)), Vec4f_Mul(ic2, r->z2)), w);
+
+			if (flags & TRI_DEPTH_TEST) {
+				skip = Vec4i_Or(skip, Vec4i_Or(Vec4f_Less(z, zero), Vec4f_Greater(z, depth)));
+				if (Vec4i_AllSet(skip)) continue;
+			}
+
+			if (!(flags & TRI_COLOR_WRITE)) {
+				if (flags & TRI_DEPTH_WRITE) Vec4f_Store(&depthBuffer[db_index], Vec4f_Select(skip, depth, z));
+				continue;
+			}
+
+			Vec4i col = r->color;
+			if (flags & TRI_TEXTURED) {
+				Vec4f u = Vec4f_Mul(Vec4f_Add(Vec4f_Add(Vec4f_Mul(ic0, r->u0), Vec4f_Mul(ic1, r->u1)), Vec4f_Mul(ic2, r->u2)), w);
+				Vec4f v = Vec4f_Mul(Vec4f_Add(Vec4f_Add(Vec4f_Mul(ic0, r->v0), Vec4f_Mul(ic1, r->v1)), Vec4f_Mul(ic2, r->v2)), w);
+				Vec4i texX = Vec4i_And(Vec4f_ToInt(Vec4f_Mul(Vec4f_Abs(Vec4f_Fract(u)), r->texWidth)),  r->texWidthMask);
+				Vec4i texY = Vec4i_And(Vec4f_ToInt(Vec4f_Mul(Vec4f_Abs(Vec4f_Fract(v)), r->texHeight)), r->texHeightMask);
+
+				// No gather instruction in SSE2/NEON, so have to fetch texels individually
+				int texXs[4], texYs[4];
+				BitmapCol texels[4];
+				Vec4i_Store(texXs, texX);
+				Vec4i_Store(texYs, texY);
+
+				for (int i = 0; i < 4; i++) 
+				{
+					texels[i] = t->texPixels[TexelIndex(texXs[i], texYs[i], t->texRowShift)];
+				}
+				col = Vec4i_MulBytes(Vec4i_Load(texels), r->color);
+			}
+
+			Vec4i alpha = Vec4i_And(Vec4i_ShiftR(col, BITMAPCOLOR_A_SHIFT), byteMask);
+			if (flags & TRI_ALPHA_TEST) {
+				skip = Vec4i_Or(skip, Vec4i_Less(alpha, minAlpha));
+				if (Vec4i_AllSet(skip)) continue;
+			}
+
+			Vec4i dst = Vec4i_Load(&colorBuffer[cb_index]);
+			if (flags & TRI_ALPHA_BLEND) {
+				// Copy alpha into the R/G/B channels (A channel is replaced by opaque afterwards)
+				alpha = Vec4i_Or(Vec4i_Or(Vec4i_ShiftL(alpha, BITMAPCOLOR_R_SHIFT), Vec4i_ShiftL(alpha, BITMAPCOLOR_G_SHIFT)),
+								 Vec4i_ShiftL(alpha, BITMAPCOLOR_B_SHIFT));
+				col   = Vec4i_BlendBytes(col, dst, alpha);
+			}
+
+			if (flags & TRI_DEPTH_WRITE) Vec4f_Store(&depthBuffer[db_index], Vec4f_Select(skip, depth, z));
+			Vec4i_Store(&colorBuffer[cb_index], Vec4i_Select(skip, dst, Vec4i_Or(col, opaque)));
+		}
+
+		for (x = max(x, minX); x <= maxX; x++)
+		{
+			int ox = x - minX, oy = y - minY;
+			RasterPixel3D(t, x, y, bc0 + ox * dx12 + oy * dy12, bc1 + ox * dx20 + oy * dy20, bc2 + ox * dx01 + oy * dy01);
+		}
+	}
+}
+#else
+// Rasterizes the given block, with bc0/bc1/bc2 being the edge functions at its top left pixel
+static void RasterBlock3D(const Triangle* t, int minX, int minY, int maxX, int maxY,
+						float bc0, float bc1, float bc2) {
+	int dx01 = t->y0 - t->y1, dy01 = t->x1 - t->x0;
+	int dx12 = t->y1 - t->y2, dy12 = t->x2 - t->x1;
+	int dx20 = t->y2 - t->y0, dy20 = t->x0 - t->x2;
+
+	for (int y = minY; y <= maxY; y++, bc0 += dy12, bc1 += dy20, bc2 += dy01) 
+	{
+		float bc0_x = bc0, bc1_x = bc1, bc2_x = bc2;
+
+		for (int x = minX; x <= maxX; x++, bc0_x += dx12, bc1_x += dx20, bc2_x += dx01) 
+		{
+			RasterPixel3D(t, x, y, bc0_x, bc1_x, bc2_x);
+		}
+	}
+}
+#endif
+
+// Recalculates the furthest depth within the given block
+static void HiZ_Refresh(int bx, int by) {
+	int minX = bx << HIZ_SHIFT, maxX = min(minX + HIZ_SIZE, fb_width);
+	int minY = by << HIZ_SHIFT, maxY = min(minY + HIZ_SIZE, fb_height);
+	int block = by * hiz_width + bx;
+	float furthest = depthBuffer[minY * db_stride + minX];
+
+	for (int y = minY; y < maxY; y++)
+		for (int x = minX; x < maxX; x++)
+	{
+		float depth = depthBuffer[y * db_stride + x];
+		if (depth > furthest) furthest = depth;
+	}
+	hizBuffer[block] = furthest;
+	hizStale[block]  = false;
+}
+
+// Whether every pixel of the triangle within the given block would fail the depth test
+static cc_bool HiZ_Occluded(const Triangle* t, int bx, int by) {
+	int block = by * hiz_width + bx;
+	if (t->minZ > hizBuffer[block]) return true;
+	if (!hizStale[block]) return false;
+
+	HiZ_Refresh(bx, by);
+	return t->minZ > hizBuffer[block];
+}
+
+static void HiZ_MarkWritten(const Triangle* t, int bx, int by) {
+	int block = by * hiz_width + bx;
+	// Depth tested writes only ever bring depth closer, so the upper bound is still valid then
+	if (!(t->flags & TRI_DEPTH_TEST)) hizBuffer[block] = max(hizBuffer[block], t->maxZ);
+	hizStale[block] = true;
+}
+
+// Whether the edge function is negative at all 4 corners of a block, i.e. the block is entirely outside that edge
+static CC_INLINE cc_bool EdgeExcludes(float bc, int dx, int dy, int width, int height, float factor) {
+	return bc * factor < 0 && (bc + width * dx) * factor < 0 
+		&& (bc + height * dy) * factor < 0 && (bc + width * dx + height * dy) * factor < 0;
+}
+
+// Rasterizes the triangle one 8x8 block at a time, skipping blocks which are entirely outside the triangle
+//  or which are entirely behind what has already been drawn there
+static void RasterTriangle3D(const Triangle* t, int minX, int minY, int maxX, int maxY) {
+	int x0 = t->x0, y0 = t->y0;
+	int x1 = t->x1, y1 = t->y1;
+	int x2 = t->x2, y2 = t->y2;
+	float factor = t->factor;
 	
 	// https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
 	// Essentially these are the deltas of edge functions between X/Y and X/Y + 1 (i.e. one X/Y step)
@@ -512,73 +1089,328 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	float bc1_start = edgeFunction(x2,y2, x0,y0, minX+0.5f,minY+0.5f);
 	float bc2_start = edgeFunction(x0,y0, x1,y1, minX+0.5f,minY+0.5f);
 
-	for (int y = minY; y <= maxY; y++, bc0_start += dy12, bc1_start += dy20, bc2_start += dy01) 
+#ifdef SOFTGPU_SIMD
+	struct RasterVec4 r;
+	SetupRasterVec4(&r, t);
+#endif
+
+	for (int by = minY >> HIZ_SHIFT; by <= (maxY >> HIZ_SHIFT); by++)
+		for (int bx = minX >> HIZ_SHIFT; bx <= (maxX >> HIZ_SHIFT); bx++)
 	{
-		float bc0 = bc0_start;
-		float bc1 = bc1_start;
-		float bc2 = bc2_start;
+		if ((t->flags & TRI_DEPTH_TEST) && HiZ_Occluded(t, bx, by)) continue;
 
-		for (int x = minX; x <= maxX; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01) 
-		{
-			float ic0 = bc0 * factor;
-			float ic1 = bc1 * factor;
-			float ic2 = bc2 * factor;
-			if (ic0 < 0 || ic1 < 0 || ic2 < 0) continue;
-			int db_index = y * db_stride + x;
+		int bMinX = max(minX, bx << HIZ_SHIFT), bMaxX = min(maxX, (bx << HIZ_SHIFT) + HIZ_SIZE - 1);
+		int bMinY = max(minY, by << HIZ_SHIFT), bMaxY = min(maxY, (by << HIZ_SHIFT) + HIZ_SIZE - 1);
+		int ox = bMinX - minX, width  = bMaxX - bMinX;
+		int oy = bMinY - minY, height = bMaxY - bMinY;
 
-			float w = 1 / (ic0 * w0 + ic1 * w1 + ic2 * w2);
-			float z = (ic0 * z0 + ic1 * z1 + ic2 * z2) * w;
+		float bc0 = bc0_start + ox * dx12 + oy * dy12;
+		float bc1 = bc1_start + ox * dx20 + oy * dy20;
+		float bc2 = bc2_start + ox * dx01 + oy * dy01;
 
-			if (depthTest && (z < 0 || z > depthBuffer[db_index])) continue;
-			if (!colWrite) {
-				if (depthWrite) depthBuffer[db_index] = z;
-				continue;
-			}
+		if (EdgeExcludes(bc0, dx12, dy12, width, height, factor)) continue;
+		if (EdgeExcludes(bc1, dx20, dy20, width, height, factor)) continue;
+		if (EdgeExcludes(bc2, dx01, dy01, width, height, factor)) continue;
 
-			int R, G, B, A;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
-				float u = (ic0 * u0 + ic1 * u1 + ic2 * u2) * w;
-				float v = (ic0 * v0 + ic1 * v1 + ic2 * v2) * w;
-				int texX = ((int)(Math_AbsF(u - FastFloor(u)) * curTexWidth )) & texWidthMask;
-				int texY = ((int)(Math_AbsF(v - FastFloor(v)) * curTexHeight)) & texHeightMask;
-				int texIndex = texY * curTexWidth + texX;
-
-				BitmapCol tColor = curTexPixels[texIndex];
-				int a1 = PackedCol_A(color), a2 = BitmapCol_A(tColor);
-				A = ( a1 * a2 ) >> 8;
-				int r1 = PackedCol_R(color), r2 = BitmapCol_R(tColor);
-				R = ( r1 * r2 ) >> 8;
-				int g1 = PackedCol_G(color), g2 = BitmapCol_G(tColor);
-				G = ( g1 * g2 ) >> 8;
-				int b1 = PackedCol_B(color), b2 = BitmapCol_B(tColor);
-				B = ( b1 * b2 ) >> 8;
-			} else {
-				R = PackedCol_R(color);
-				G = PackedCol_G(color);
-				B = PackedCol_B(color);
-				A = PackedCol_A(color);
-			}
+#ifdef SOFTGPU_SIMD
+		RasterBlock3D(t, &r, bMinX, bMinY, bMaxX, bMaxY, bc0, bc1, bc2);
+#else
+		RasterBlock3D(t, bMinX, bMinY, bMaxX, bMaxY, bc0, bc1, bc2);
+#endif
+		if (t->flags & TRI_DEPTH_WRITE) HiZ_MarkWritten(t, bx, by);
+	}
+}
 
-			if (gfx_alphaTest && A < 0x80) continue;
-			int cb_index = y * cb_stride + x;
-			
-			if (gfx_alphaBlend) {
-				BitmapCol dst = colorBuffer[cb_index];
-				int dstR = BitmapCol_R(dst);
-				int dstG = BitmapCol_G(dst);
-				int dstB = BitmapCol_B(dst);
+// Rasterizes the part of the triangle that lies within the given region of the framebuffer
+static void RasterTriangle(const Triangle* t, int minX, int minY, int maxX, int maxY) {
+	minX = max(minX, t->minX); maxX = min(maxX, t->maxX);
+	minY = max(minY, t->minY); maxY = min(maxY, t->maxY);
+	if (minX > maxX || minY > maxY) return;
 
-				R = (R * A + dstR * (255 - A)) >> 8;
-				G = (G * A + dstG * (255 - A)) >> 8;
-				B = (B * A + dstB * (255 - A)) >> 8;
-			}
+	if (t->flags & TRI_3D) {
+		RasterTriangle3D(t, minX, minY, maxX, maxY);
+	} else {
+		RasterTriangle2D(t, minX, minY, maxX, maxY);
+	}
+}
 
-			if (depthWrite) depthBuffer[db_index] = z;
-			colorBuffer[cb_index] = BitmapCol_Make(R, G, B, 0xFF);
+
+/*########################################################################################################################*
+*--------------------------------------------------------Tile binning-----------------------------------------------------*
+*#########################################################################################################################*/
+// Rather than being rasterized immediately, triangles are set up once and then binned into the screen tiles they overlap.
+// When the batch is flushed, worker threads each claim whole tiles and rasterize all of the triangles binned into them.
+// Since only one thread ever touches a given tile's colour and depth pixels, no locking is needed while rasterizing,
+//  and since each tile's triangles are rasterized in submission order, alpha blending still produces the same results.
+#define TILE_SHIFT 6
+#define TILE_SIZE  (1 << TILE_SHIFT)
+#define MAX_BINNED_TRIS 8192
+#define RAST_WORKERS_COUNT 4
+
+struct TileBin {
+	cc_uint16* tris;
+	int count, capacity;
+};
+
+static Triangle* tri_buffer;
+static int tri_count;
+static Triangle immediate_tri;
+
+static struct TileBin* tile_bins;
+static int tilesX, tilesY, tilesCount;
+// Whether any binned triangles write depth without depth testing, which might move depth further away
+static cc_bool binned_untestedDepth;
+
+#ifdef CC_BUILD_COOPTHREADED
+// Without real threads, binning would only add overhead, so triangles are always rasterized immediately
+static void StartRastWorkers(void) { }
+static void StopRastWorkers(void)  { }
+static void FlushTriangles(void)   { }
+#else
+static struct RastWorkers {
+	void* Threads[RAST_WORKERS_COUNT];
+	void* Waits[RAST_WORKERS_COUNT];
+	void* TilesDone;
+	void* Mutex;
+	int NextTile, NumDone, NumStarted;
+	cc_bool Stopping, Running;
+} rast_workers;
+
+static void RasterTile(int tile) {
+	struct TileBin* bin = &tile_bins[tile];
+	int minX = (tile % tilesX) << TILE_SHIFT;
+	int minY = (tile / tilesX) << TILE_SHIFT;
+	int i;
+
+	for (i = 0; i < bin->count; i++)
+	{
+		RasterTriangle(&tri_buffer[bin->tris[i]], minX, minY,
+						minX + TILE_SIZE - 1, minY + TILE_SIZE - 1);
+	}
+	bin->count = 0;
+}
+
+static void RasterTiles(void) {
+	int tile;
+	for (;;) 
+	{
+		Mutex_Lock(rast_workers.Mutex);
+		tile = rast_workers.NextTile++;
+		Mutex_Unlock(rast_workers.Mutex);
+
+		if (tile >= tilesCount) return;
+		RasterTile(tile);
+	}
+}
+
+static void RastWorker_Run(void) {
+	cc_bool stopping;
+	int id;
+
+	Mutex_Lock(rast_workers.Mutex);
+	id = rast_workers.NumStarted++;
+	Mutex_Unlock(rast_workers.Mutex);
+
+	for (;;)
+	{
+		Waitable_Wait(rast_workers.Waits[id]);
+		Mutex_Lock(rast_workers.Mutex);
+		stopping = rast_workers.Stopping;
+		Mutex_Unlock(rast_workers.Mutex);
+		if (stopping) return;
+
+		RasterTiles();
+		Mutex_Lock(rast_workers.Mutex);
+		rast_workers.NumDone++;
+		Mutex_Unlock(rast_workers.Mutex);
+		Waitable_Signal(rast_workers.TilesDone);
+	}
+}
+
+static void StartRastWorkers(void) {
+	int i;
+	if (rast_workers.Running) return;
+
+	tri_buffer = (Triangle*)Mem_TryAlloc(MAX_BINNED_TRIS, sizeof(Triangle));
+	// Not having enough memory isn't a problem, since can just rasterize triangles immediately
+	if (!tri_buffer) return;
+
+	rast_workers.NumStarted = 0;
+	rast_workers.Stopping   = false;
+	rast_workers.Running    = true;
+
+	rast_workers.Mutex     = Mutex_Create("Rasterizer tiles");
+	rast_workers.TilesDone = Waitable_Create("Rasterizer tiles done");
+	for (i = 0; i < RAST_WORKERS_COUNT; i++)
+	{
+		rast_workers.Waits[i] = Waitable_Create("Rasterizer tiles queued");
+		Thread_Run(&rast_workers.Threads[i], RastWorker_Run, 64 * 1024, "Rasterizer worker");
+	}
+	if (fb_width) AllocTileBins();
+}
+
+static void StopRastWorkers(void) {
+	int i;
+	if (!rast_workers.Running) return;
+
+	Mutex_Lock(rast_workers.Mutex);
+	rast_workers.Stopping = true;
+	Mutex_Unlock(rast_workers.Mutex);
+
+	for (i = 0; i < RAST_WORKERS_COUNT; i++) { Waitable_Signal(rast_workers.Waits[i]); }
+	for (i = 0; i < RAST_WORKERS_COUNT; i++) 
+	{
+		Thread_Join(rast_workers.Threads[i]);
+		Waitable_Free(rast_workers.Waits[i]);
+	}
+
+	Waitable_Free(rast_workers.TilesDone);
+	Mutex_Free(rast_workers.Mutex);
+	Mem_Free(tri_buffer);
+
+	tri_buffer = NULL;
+	rast_workers.Running = false;
+}
+
+// Rasterizes all of the binned triangles, and waits for that to finish
+static void FlushTriangles(void) {
+	int i, numDone, workers;
+	if (!tri_count) return;
+	// Waking up the workers isn't worth it for just a few triangles (e.g. a single 2D texture)
+	workers = tri_count >= 64 ? RAST_WORKERS_COUNT : 0;
+
+	Mutex_Lock(rast_workers.Mutex);
+	rast_workers.NextTile = 0;
+	rast_workers.NumDone  = 0;
+	Mutex_Unlock(rast_workers.Mutex);
+
+	for (i = 0; i < workers; i++) { Waitable_Signal(rast_workers.Waits[i]); }
+	RasterTiles();
+
+	for (;;)
+	{
+		Mutex_Lock(rast_workers.Mutex);
+		numDone = rast_workers.NumDone;
+		Mutex_Unlock(rast_workers.Mutex);
+
+		if (numDone == workers) break;
+		Waitable_Wait(rast_workers.TilesDone);
+	}
+	tri_count = 0;
+	binned_untestedDepth = false;
+}
+#endif
+
+static void AllocTileBins(void) {
+	if (!tri_buffer) return;
+	tilesX     = Math_CeilDiv(fb_width,  TILE_SIZE);
+	tilesY     = Math_CeilDiv(fb_height, TILE_SIZE);
+	tilesCount = tilesX * tilesY;
+	tile_bins  = (struct TileBin*)Mem_TryAllocCleared(tilesCount, sizeof(struct TileBin));
+}
+
+static void FreeTileBins(void) {
+	int i;
+	if (!tile_bins) return;
+
+	for (i = 0; i < tilesCount; i++) 
+	{
+		Mem_Free(tile_bins[i].tris);
+	}
+	Mem_Free(tile_bins);
+	tile_bins = NULL;
+}
+
+static cc_bool TileBin_Reserve(struct TileBin* bin) {
+	cc_uint16* tris;
+	int capacity;
+	if (bin->count < bin->capacity) return true;
+
+	capacity = bin->capacity ? bin->capacity * 2 : 32;
+	tris     = (cc_uint16*)Mem_TryRealloc(bin->tris, capacity, 2);
+	if (!tris) return false;
+
+	bin->tris     = tris;
+	bin->capacity = capacity;
+	return true;
+}
+
+// Returns where the next triangle should be set up
+static Triangle* AllocTriangle(void) {
+	if (!tile_bins) return &immediate_tri;
+
+	if (tri_count == MAX_BINNED_TRIS) FlushTriangles();
+	return &tri_buffer[tri_count];
+}
+
+// Whether the triangle is entirely behind what has already been drawn
+static cc_bool TriangleOccluded(const Triangle* t) {
+	int minBX = t->minX >> HIZ_SHIFT, maxBX = t->maxX >> HIZ_SHIFT;
+	int minBY = t->minY >> HIZ_SHIFT, maxBY = t->maxY >> HIZ_SHIFT;
+	int bx, by;
+
+	if (!(t->flags & TRI_3D) || !(t->flags & TRI_DEPTH_TEST)) return false;
+	// Large triangles are checked block by block while rasterizing instead
+	if ((maxBX - minBX + 1) * (maxBY - minBY + 1) > 16) return false;
+
+	for (by = minBY; by <= maxBY; by++)
+		for (bx = minBX; bx <= maxBX; bx++)
+		{
+			if (!HiZ_Occluded(t, bx, by)) return false;
 		}
+	return true;
+}
+
+// Adds the triangle to the bin of every tile its bounds overlap, or rasterizes it immediately without tile bins
+static void SubmitTriangle(Triangle* t) {
+	int minTX = t->minX >> TILE_SHIFT, maxTX = t->maxX >> TILE_SHIFT;
+	int minTY = t->minY >> TILE_SHIFT, maxTY = t->maxY >> TILE_SHIFT;
+	int tx, ty;
+	Triangle tmp;
+
+	if (!binned_untestedDepth && TriangleOccluded(t)) return;
+	if (!tile_bins) { 
+		RasterTriangle(t, 0, 0, fb_maxX, fb_maxY); return;
 	}
+
+	for (ty = minTY; ty <= maxTY; ty++)
+		for (tx = minTX; tx <= maxTX; tx++)
+		{
+			if (!TileBin_Reserve(&tile_bins[ty * tilesX + tx])) goto outOfMemory;
+		}
+
+	for (ty = minTY; ty <= maxTY; ty++)
+		for (tx = minTX; tx <= maxTX; tx++)
+		{
+			struct TileBin* bin = &tile_bins[ty * tilesX + tx];
+			bin->tris[bin->count++] = tri_count;
+		}
+	tri_count++;
+
+	if ((t->flags & TRI_DEPTH_WRITE) && !(t->flags & TRI_DEPTH_TEST)) binned_untestedDepth = true;
+	return;
+
+outOfMemory:
+	// Rasterize everything binned so far first, so triangles are still drawn in order
+	tmp = *t;
+	FlushTriangles();
+	RasterTriangle(&tmp, 0, 0, fb_maxX, fb_maxY);
+}
+
+static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+	Triangle* t = AllocTriangle();
+	if (SetupTriangle2D(t, V0, V1, V2)) SubmitTriangle(t);
+}
+
+static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
+	Triangle* t = AllocTriangle();
+	if (SetupTriangle3D(t, V0, V1, V2)) SubmitTriangle(t);
 }
 
+
+/*########################################################################################################################*
+*----------------------------------------------------------Drawing--------------------------------------------------------*
+*#########################################################################################################################*/
 #define V0_VIS (1 << 0)
 #define V1_VIS (1 << 1)
 #define V2_VIS (1 << 2)
@@ -916,6 +1748,7 @@ static BitmapCol* CB_GetRow(struct Bitmap* bmp, int y, void* ctx) {
 cc_result Gfx_TakeScreenshot(struct Stream* output) {
 	struct Bitmap bmp;
 	Bitmap_Init(bmp, fb_width, fb_height, NULL);
+	FlushTriangles();
 	return Png_Encode(&bmp, output, CB_GetRow, false, NULL);
 }
 
@@ -926,6 +1759,7 @@ void Gfx_BeginFrame(void) { }
 
 void Gfx_EndFrame(void) {
 	Rect2D r = { 0, 0, fb_width, fb_height };
+	FlushTriangles();
 	Window_DrawFramebuffer(r, &fb_bmp);
 }
 
@@ -934,6 +1768,7 @@ void Gfx_SetVSync(cc_bool vsync) {
 }
 
 void Gfx_OnWindowResize(void) {
+	int i;
 	if (depthBuffer) DestroyBuffers();
 
 	fb_width   = Game.Width;
@@ -946,6 +1781,14 @@ void Gfx_OnWindowResize(void) {
 	depthBuffer = Mem_Alloc(fb_width * fb_height, 4, "depth buffer");
 	db_stride   = fb_width;
 
+	hiz_width  = Math_CeilDiv(fb_width,  HIZ_SIZE);
+	hiz_height = Math_CeilDiv(fb_height, HIZ_SIZE);
+	hizBuffer  = Mem_Alloc(hiz_width * hiz_height, 4, "coarse depth buffer");
+	hizStale   = Mem_AllocCleared(hiz_width * hiz_height, 1, "coarse depth flags");
+	// Depth buffer contents are undefined until it is first cleared
+	for (i = 0; i < hiz_width * hiz_height; i++) hizBuffer[i] = MATH_LARGENUM;
+	AllocTileBins();
+
 	Gfx_SetViewport(0, 0, Game.Width, Game.Height);
 	Gfx_SetScissor (0, 0, Game.Width, Game.Height);
 }
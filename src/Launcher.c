@@ -417,12 +417,6 @@ static void ExtractTerrainTiles(struct Bitmap* bmp) {
 	TintBitmap(&stoneBmp, 96, 96, TILESIZE, TILESIZE);
 }
 
-static cc_bool Launcher_SelectZipEntry(const cc_string* path) {
-	return
-		String_CaselessEqualsConst(path, "default.png") ||
-		String_CaselessEqualsConst(path, "terrain.png");
-}
-
 static cc_result Launcher_ProcessZipEntry(const cc_string* path, struct Stream* data, struct ZipEntry* source) {
 	struct Bitmap bmp;
 	cc_result res;
@@ -455,17 +449,31 @@ static cc_result Launcher_ProcessZipEntry(const cc_string* path, struct Stream*
 }
 
 static cc_result ExtractTexturePack(const cc_string* path) {
-	struct ZipEntry entries[32];
-	struct Stream stream;
+	static const cc_string names[] = { String_FromConst("default.png"), String_FromConst("terrain.png") };
+	struct ZipIndex index;
+	struct Stream stream, entryStream;
+	cc_uint8* data;
 	cc_result res;
+	int i, entry;
 
 	res = Stream_OpenFile(&stream, path);
 	if (res == ReturnCode_FileNotFound) return res;
 	if (res) { Logger_SysWarn(res, "opening texture pack"); return res; }
 
-	res = Zip_Extract(&stream, 
-			Launcher_SelectZipEntry, Launcher_ProcessZipEntry,
-			entries, Array_Elems(entries));
+	/* Only need a couple of the entries, so just look them up directly */
+	res = ZipIndex_Read(&index, &stream);
+	for (i = 0; !res && i < Array_Elems(names); i++)
+	{
+		entry = ZipIndex_Find(&index, &names[i]);
+		if (entry == -1) continue;
+		if ((res = ZipIndex_ReadEntry(&index, entry, &data))) break;
+
+		Stream_ReadonlyMemory(&entryStream, data, index.entries[entry].UncompressedSize);
+		res = Launcher_ProcessZipEntry(&names[i], &entryStream, &index.entries[entry]);
+		Mem_Free(data);
+	}
+
+	ZipIndex_Free(&index);
 	if (res) { Logger_SysWarn(res, "extracting texture pack"); }
 	/* No point logging error for closing readonly file */
 	(void)stream.Close(&stream);
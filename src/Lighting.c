@@ -194,8 +194,11 @@ static cc_bool ClassicLighting_NeedsNeighour(BlockID block, int i, int minY, int
 static void ClassicLighting_ResetNeighbour(int x, int y, int z, BlockID block, int cx, int cy, int cz, int minCy, int maxCy) {
 	int minY, maxY;
 
+	/* Changing many blocks at once usually affects the same neighbouring chunks, */
+	/*  so avoid scanning blocks of chunks that will already be rebuilt anyways */
 	if (minCy == maxCy) {
 		minY = cy << CHUNK_SHIFT;
+		if (!MapRenderer_NeedsRefresh(cx, cy, cz)) return;
 
 		if (ClassicLighting_NeedsNeighour(block, World_Pack(x, y, z), minY, y, y)) {
 			MapRenderer_RefreshChunk(cx, cy, cz);
@@ -205,6 +208,7 @@ static void ClassicLighting_ResetNeighbour(int x, int y, int z, BlockID block, i
 			minY = (cy << CHUNK_SHIFT); 
 			maxY = (cy << CHUNK_SHIFT) + CHUNK_MAX;
 			if (maxY > World.MaxY) maxY = World.MaxY;
+			if (!MapRenderer_NeedsRefresh(cx, cy, cz)) continue;
 
 			if (ClassicLighting_NeedsNeighour(block, World_Pack(x, maxY, z), minY, maxY, y)) {
 				MapRenderer_RefreshChunk(cx, cy, cz);
@@ -237,7 +241,7 @@ static void ClassicLighting_RefreshAffected(int x, int y, int z, BlockID block,
 	if (bX == 0 && cx > 0) {
 		ClassicLighting_ResetNeighbour(x - 1, y, z, block, cx - 1, cy, cz, minCy, maxCy);
 	}
-	if (bY == 0 && cy > 0 && ClassicLighting_Needs(block, World_GetBlock(x, y - 1, z))) {
+	if (bY == 0 && cy > 0 && MapRenderer_NeedsRefresh(cx, cy - 1, cz) && ClassicLighting_Needs(block, World_GetBlock(x, y - 1, z))) {
 		MapRenderer_RefreshChunk(cx, cy - 1, cz);
 	}
 	if (bZ == 0 && cz > 0) {
@@ -247,7 +251,7 @@ static void ClassicLighting_RefreshAffected(int x, int y, int z, BlockID block,
 	if (bX == 15 && cx < World.ChunksX - 1) {
 		ClassicLighting_ResetNeighbour(x + 1, y, z, block, cx + 1, cy, cz, minCy, maxCy);
 	}
-	if (bY == 15 && cy < World.ChunksY - 1 && ClassicLighting_Needs(block, World_GetBlock(x, y + 1, z))) {
+	if (bY == 15 && cy < World.ChunksY - 1 && MapRenderer_NeedsRefresh(cx, cy + 1, cz) && ClassicLighting_Needs(block, World_GetBlock(x, y + 1, z))) {
 		MapRenderer_RefreshChunk(cx, cy + 1, cz);
 	}
 	if (bZ == 15 && cz < World.ChunksZ - 1) {
@@ -77,6 +77,8 @@ static const char* GetCCErrorDesc(cc_result res) {
 	case WAV_ERR_DATA_TYPE:   return "Unsupported WAV audio format";
 
 	case ZIP_ERR_TOO_MANY_ENTRIES: return "Cannot load .zip files with over 1024 entries";
+	case ZIP_ERR_CRC32:            return "Corrupted .zip file entry";
+	case ZIP_ERR_PATHS_LENGTH:     return "Cannot load .zip files with over 4 MB of file names";
 
 	case PNG_ERR_INVALID_SIG:      return "Only PNG images supported";
 	case PNG_ERR_INVALID_HDR_SIZE: return "Invalid PNG header size";
@@ -92,6 +94,11 @@ static const char* GetCCErrorDesc(cc_result res) {
 	case CW_ERR_ROOT_TAG:   return "Invalid root NBT tag";
 	case CW_ERR_STRING_LEN: return "NBT string too long";
 
+	case CCMAP_ERR_IDENTIFIER: return "Invalid .ccmap map file";
+	case CCMAP_ERR_VERSION:    return "Unsupported .ccmap format version";
+	case CCMAP_ERR_SLICE_SIZE: return "Invalid .ccmap compressed block data size";
+	case CCMAP_ERR_DIMENSIONS: return "Invalid .ccmap world dimensions";
+
 	case ERR_DOWNLOAD_INVALID: return "Website denied download or doesn't exist";
 	case ERR_NO_AUDIO_OUTPUT:  return "No audio output devices plugged in";
 	case ERR_INVALID_DATA_URL: return "Cannot download from invalid URL";
@@ -522,6 +522,8 @@ static void RefreshBorderChunks(int maxHeight) {
 *#########################################################################################################################*/
 #define CHUNK_TARGET_TIME ((1.0f/30) + 0.01f)
 static int chunksTarget = 12;
+/* Chunk build rate that chunksTarget is being ramped up to after a new map loads (0 if not ramping) */
+static int chunksRampTarget;
 static Vec3 lastCamPos;
 static float lastYaw, lastPitch;
 /* Max distance from camera that chunks are rendered within */
@@ -616,8 +618,17 @@ static void UpdateChunks(float delta) {
 	cc_bool samePos;
 	int chunkUpdates = 0;
 
-	/* Build more chunks if 30 FPS or over, otherwise slowdown */
-	chunksTarget += delta < CHUNK_TARGET_TIME ? 1 : -1; 
+	if (chunksRampTarget && delta < CHUNK_TARGET_TIME) {
+		/* Double the build rate each fast frame, until reaching the normal target */
+		chunksTarget *= 2;
+		if (chunksTarget >= chunksRampTarget) {
+			chunksTarget = chunksRampTarget; chunksRampTarget = 0;
+		}
+	} else {
+		/* Build more chunks if 30 FPS or over, otherwise slowdown */
+		chunksTarget += delta < CHUNK_TARGET_TIME ? 1 : -1; 
+		chunksRampTarget = 0;
+	}
 	Math_Clamp(chunksTarget, 4, maxChunkUpdates);
 
 	p = Entities.CurPlayer;
@@ -714,6 +725,14 @@ void MapRenderer_RefreshChunk(int cx, int cy, int cz) {
 	info->dirty = true;
 }
 
+cc_bool MapRenderer_NeedsRefresh(int cx, int cy, int cz) {
+	struct ChunkInfo* info;
+	if (cx < 0 || cy < 0 || cz < 0 || cx >= World.ChunksX || cy >= World.ChunksY || cz >= World.ChunksZ) return false;
+
+	info = &mapChunks[World_ChunkPack(cx, cy, cz)];
+	return !info->allAir && !info->dirty;
+}
+
 void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block) {
 	int cx = x >> CHUNK_SHIFT, cy = y >> CHUNK_SHIFT, cz = z >> CHUNK_SHIFT;
 	struct ChunkInfo* chunk;
@@ -724,6 +743,27 @@ void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block) {
 	MapRenderer_RefreshChunk(cx, cy, cz);
 }
 
+void MapRenderer_RefreshRegion(int x1, int y1, int z1, int x2, int y2, int z2) {
+	int cx1 = max(0, x1 >> CHUNK_SHIFT), cx2 = min(World.ChunksX - 1, x2 >> CHUNK_SHIFT);
+	int cy1 = max(0, y1 >> CHUNK_SHIFT), cy2 = min(World.ChunksY - 1, y2 >> CHUNK_SHIFT);
+	int cz1 = max(0, z1 >> CHUNK_SHIFT), cz2 = min(World.ChunksZ - 1, z2 >> CHUNK_SHIFT);
+	struct ChunkInfo* info;
+	int cx, cy, cz;
+
+	for (cy = cy1; cy <= cy2; cy++) {
+		for (cz = cz1; cz <= cz2; cz++) {
+			for (cx = cx1; cx <= cx2; cx++) {
+				info = &mapChunks[World_ChunkPack(cx, cy, cz)];
+				/* Blocks may have been placed in a previously entirely air chunk */
+				/*  (allAir gets recalculated anyways when the chunk is rebuilt) */
+				info->allAir = false;
+				info->empty  = false;
+				info->dirty  = true;
+			}
+		}
+	}
+}
+
 static void OnEnvVariableChanged(void* obj, int envVar) {
 	if (envVar == ENV_VAR_SUN_COLOR || envVar == ENV_VAR_SHADOW_COLOR) {
 		MapRenderer_Refresh();
@@ -785,6 +825,12 @@ static void OnNewMapLoaded(void) {
 
 	InitChunks();
 	lastCamPos = Vec3_BigPos();
+	/* Nothing has been built yet, so start with a low chunk build rate to show the nearest */
+	/*  chunks quickly, then ramp up to the previous rate over the next few frames. */
+	/*  (a slow frame stops the ramp, leaving the rate to be adjusted by 1 per frame as usual) */
+	chunksRampTarget = chunksTarget;
+	chunksTarget     = 4;
+	if (chunksRampTarget <= chunksTarget) chunksRampTarget = 0;
 }
 
 static void OnInit(void) {
@@ -73,8 +73,14 @@ void MapRenderer_Update(float delta);
 /* Marks the given chunk as needing to be rebuilt/redrawn. */
 /* NOTE: Coordinates outside the map are simply ignored. */
 void MapRenderer_RefreshChunk(int cx, int cy, int cz);
+/* Whether calling MapRenderer_RefreshChunk on the given chunk would have any effect. */
+/* (i.e. false when chunk is outside the map, entirely air, or already waiting to be rebuilt) */
+cc_bool MapRenderer_NeedsRefresh(int cx, int cy, int cz);
 /* Called when a block is changed, to update internal state. */
 void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block);
+/* Marks all chunks containing any part of the given region as needing to be rebuilt/redrawn. */
+/* NOTE: Should be called after blocks in the region are changed using Game_UpdateBlockState. */
+void MapRenderer_RefreshRegion(int x1, int y1, int z1, int x2, int y2, int z2);
 /* Deletes all chunks and resets internal state. */
 void MapRenderer_Refresh(void);
 
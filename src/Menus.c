@@ -1332,14 +1332,20 @@ static void SaveLevelScreen_RemoveOverwrites(struct SaveLevelScreen* s) {
 static cc_result DoSaveMap(const cc_string* path, struct GZipState* state) {
 	static const cc_string schematic = String_FromConst(".schematic");
 	static const cc_string mine      = String_FromConst(".mine");
+	static const cc_string ccmap     = String_FromConst(".ccmap");
 	struct Stream stream, compStream;
+	cc_bool compressed = true;
 	cc_result res;
 
 	res = Stream_CreateFile(&stream, path);
 	if (res) { Logger_SysWarn2(res, "creating", path); return res; }
 	GZip_MakeStream(&compStream, state, &stream);
 
-	if (String_CaselessEnds(path, &schematic)) {
+	if (String_CaselessEnds(path, &ccmap)) {
+		/* .ccmap files compress parts of the map separately */
+		res = CcMap_Save(&stream);
+		compressed = false;
+	} else if (String_CaselessEnds(path, &schematic)) {
 		res = Schematic_Save(&compStream);
 	} else if (String_CaselessEnds(path, &mine)) {
 		res = Dat_Save(&compStream);
@@ -1352,7 +1358,7 @@ static cc_result DoSaveMap(const cc_string* path, struct GZipState* state) {
 		Logger_SysWarn2(res, "encoding", path); return res;
 	}
 
-	if ((res = compStream.Close(&compStream))) {
+	if (compressed && (res = compStream.Close(&compStream))) {
 		stream.Close(&stream);
 		Logger_SysWarn2(res, "closing", path); return res;
 	}
@@ -1415,10 +1421,10 @@ static void SaveLevelScreen_UploadCallback(const cc_string* path) {
 
 static void SaveLevelScreen_File(void* screen, void* b) {
 	static const char* const titles[] = {
-		"ClassiCube map", "Minecraft schematic", "Minecraft classic map", NULL
+		"ClassiCube map", "Minecraft schematic", "Minecraft classic map", "ClassiCube chunked map", NULL
 	};
 	static const char* const filters[] = {
-		".cw", ".schematic", ".mine", NULL
+		".cw", ".schematic", ".mine", ".ccmap", NULL
 	};
 	struct SaveLevelScreen* s = (struct SaveLevelScreen*)screen;
 	struct SaveFileDialogArgs args;
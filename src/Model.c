@@ -104,8 +104,11 @@ void Model_GetEntityTransform(struct Model* model, struct Entity* e, struct Matr
 	model->GetTransform(e, pos, transform);
 }
 
+static cc_bool Model_TryBatch(struct Model* model, struct Entity* e);
+
 void Model_Render(struct Model* model, struct Entity* e) {
 	struct Matrix m, transform;
+	if (Model_TryBatch(model, e)) return;
 	Model_SetupState(model, e);
 	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
 
@@ -149,8 +152,8 @@ void Model_SetupState(struct Model* model, struct Entity* e) {
 	Models.Active  = model;
 }
 
-void Model_ApplyTexture(struct Entity* e) {
-	struct Model* model = Models.Active;
+/* Calculates the skin type and UV scale of the texture the given entity is drawn with */
+static GfxResourceID Model_CalcTexture(struct Model* model, struct Entity* e) {
 	struct ModelTex* data;
 	GfxResourceID tex;
 	cc_bool _64x64;
@@ -164,11 +167,14 @@ void Model_ApplyTexture(struct Entity* e) {
 		Models.skinType = data->skinType;
 	}
 
-	Gfx_BindTexture(tex);
 	_64x64 = Models.skinType != SKIN_64x32;
-
 	Models.uScale = e->uScale * 0.015625f;
 	Models.vScale = e->vScale * (_64x64 ? 0.015625f : 0.03125f);
+	return tex;
+}
+
+void Model_ApplyTexture(struct Entity* e) {
+	Gfx_BindTexture(Model_CalcTexture(Models.Active, e));
 }
 
 
@@ -209,14 +215,127 @@ void Model_UnlockVB(void) {
 }
 
 
+/*########################################################################################################################*
+*------------------------------------------------------Model meshes-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Vertices of models whose geometry never changes are cached already converted to VertexTextured, */
+/*  so drawing a part only needs to copy vertices and apply tint/rotation instead of decoding them */
+#define MESH_CACHE_SIZE 32
+struct ModelMesh {
+	struct Model* model;
+	struct ModelVertex* src;
+	float uScale, vScale;
+	int capacity;
+	cc_uint8* converted; /* Whether each vertex has been converted yet */
+	struct VertexTextured* vertices;
+};
+static struct ModelMesh meshCache[MESH_CACHE_SIZE];
+
+static void ModelMesh_Convert(struct ModelMesh* mesh, int offset, int count) {
+	struct ModelVertex* src    = &mesh->src[offset];
+	struct VertexTextured* dst = &mesh->vertices[offset];
+	float uScale = mesh->uScale, vScale = mesh->vScale;
+	struct ModelVertex v;
+	int i;
+
+	for (i = 0; i < count; i++, src++, dst++) 
+	{
+		v = *src;
+		dst->x = v.x; dst->y = v.y; dst->z = v.z;
+		dst->Col = PACKEDCOL_WHITE;
+
+		dst->U = (v.u & UV_POS_MASK) * uScale - (v.u >> UV_MAX_SHIFT) * 0.01f * uScale;
+		dst->V = (v.v & UV_POS_MASK) * vScale - (v.v >> UV_MAX_SHIFT) * 0.01f * vScale;
+	}
+	Mem_Set(&mesh->converted[offset], true, count);
+}
+
+static cc_bool ModelMesh_Reserve(struct ModelMesh* mesh, int count) {
+	struct VertexTextured* vertices;
+	cc_uint8* converted;
+	if (count <= mesh->capacity) return true;
+
+	vertices  = (struct VertexTextured*)Mem_TryRealloc(mesh->vertices, count, sizeof(struct VertexTextured));
+	if (!vertices)  return false;
+	mesh->vertices = vertices;
+
+	converted = (cc_uint8*)Mem_TryRealloc(mesh->converted, count, 1);
+	if (!converted) return false;
+	mesh->converted = converted;
+
+	Mem_Set(&converted[mesh->capacity], false, count - mesh->capacity);
+	mesh->capacity = count;
+	return true;
+}
+
+/* Returns the converted vertices of the given part, or NULL if they can't be cached */
+static struct VertexTextured* ModelMesh_Get(struct ModelPart* part) {
+	struct Model* model = Models.Active;
+	int offset = part->offset, end = part->offset + part->count;
+	struct ModelMesh* mesh;
+	cc_uint32 hash;
+	if (!(model->flags & MODEL_FLAG_STATIC_MESH)) return NULL;
+
+	/* Same model can be drawn with different skin sizes, so cache each combination separately */
+	hash = (cc_uint32)((cc_uintptr)model >> 3) 
+		+ (cc_uint32)(Models.uScale * 65536.0f) * 31 + (cc_uint32)(Models.vScale * 65536.0f) * 17;
+	mesh = &meshCache[hash & (MESH_CACHE_SIZE - 1)];
+
+	if (mesh->model != model || mesh->src != model->vertices || 
+		mesh->uScale != Models.uScale || mesh->vScale != Models.vScale) {
+		mesh->model  = model;
+		mesh->src    = model->vertices;
+		mesh->uScale = Models.uScale;
+		mesh->vScale = Models.vScale;
+		if (mesh->converted) Mem_Set(mesh->converted, false, mesh->capacity);
+	}
+
+	if (!ModelMesh_Reserve(mesh, end)) { mesh->model = NULL; return NULL; }
+	if (!mesh->converted[offset] || !mesh->converted[end - 1]) {
+		ModelMesh_Convert(mesh, offset, part->count);
+	}
+	return &mesh->vertices[offset];
+}
+
+static void ModelMesh_Invalidate(struct Model* model) {
+	int i;
+	for (i = 0; i < MESH_CACHE_SIZE; i++) 
+	{
+		if (meshCache[i].model == model) meshCache[i].model = NULL;
+	}
+}
+
+static void ModelMesh_FreeAll(void) {
+	int i;
+	for (i = 0; i < MESH_CACHE_SIZE; i++) 
+	{
+		Mem_Free(meshCache[i].vertices);
+		Mem_Free(meshCache[i].converted);
+	}
+	Mem_Set(meshCache, 0, sizeof(meshCache));
+}
+
+
 void Model_DrawPart(struct ModelPart* part) {
 	struct Model* model        = Models.Active;
 	struct ModelVertex* src    = &model->vertices[part->offset];
 	struct VertexTextured* dst = &Models.Vertices[model->index];
+	struct VertexTextured* mesh;
 
 	struct ModelVertex v;
 	int i, count = part->count;
 
+	mesh = ModelMesh_Get(part);
+	if (mesh) {
+		for (i = 0; i < count; i++, mesh++, dst++) 
+		{
+			*dst = *mesh;
+			dst->Col = Models.Cols[i >> 2];
+		}
+		model->index += count;
+		return;
+	}
+
 	for (i = 0; i < count; i++) {
 		v = *src;
 		dst->x = v.x; dst->y = v.y; dst->z = v.z;
@@ -233,22 +352,25 @@ void Model_DrawPart(struct ModelPart* part) {
 #define Model_RotateY t = cosY * v.x - sinY * v.z; v.z =  sinY * v.x + cosY * v.z; v.x = t;
 #define Model_RotateZ t = cosZ * v.x + sinZ * v.y; v.y = -sinZ * v.x + cosZ * v.y; v.x = t;
 
-void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart* part, cc_bool head) {
-	struct Model* model        = Models.Active;
-	struct ModelVertex* src    = &model->vertices[part->offset];
-	struct VertexTextured* dst = &Models.Vertices[model->index];
+/* Rotation of a part is the same for every vertex, so is calculated once as a 3x3 matrix */
+/*  (by rotating each axis), rather than applying each individual rotation to every vertex */
+struct PartRotation { Vec3 axisX, axisY, axisZ; };
 
+static void Model_CalcRotation(struct PartRotation* r, float angleX, float angleY, float angleZ, cc_bool head) {
 	float cosX = Math_CosF(-angleX), sinX = Math_SinF(-angleX);
 	float cosY = Math_CosF(-angleY), sinY = Math_SinF(-angleY);
 	float cosZ = Math_CosF(-angleZ), sinZ = Math_SinF(-angleZ);
-	float t, x = part->rotX, y = part->rotY, z = part->rotZ;
-	
-	struct ModelVertex v;
-	int i, count = part->count;
+	Vec3* axes[3];
+	float t;
+	Vec3 v;
+	int i;
+	axes[0] = &r->axisX; axes[1] = &r->axisY; axes[2] = &r->axisZ;
 
-	for (i = 0; i < count; i++) {
-		v = *src;
-		v.x -= x; v.y -= y; v.z -= z;
+	for (i = 0; i < 3; i++) 
+	{
+		v.x = i == 0 ? 1.0f : 0.0f;
+		v.y = i == 1 ? 1.0f : 0.0f;
+		v.z = i == 2 ? 1.0f : 0.0f;
 
 		/* Rotate locally */
 		if (Models.Rotation == ROTATE_ORDER_ZYX) {
@@ -273,7 +395,46 @@ void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart
 		if (head) {
 			t = Models.cosHead * v.x - Models.sinHead * v.z; v.z = Models.sinHead * v.x + Models.cosHead * v.z; v.x = t;
 		}
-		dst->x = v.x + x; dst->y = v.y + y; dst->z = v.z + z;
+		*axes[i] = v;
+	}
+}
+
+#define Model_ApplyRotation(dst, vx, vy, vz) \
+	dst->x = vx * r.axisX.x + vy * r.axisY.x + vz * r.axisZ.x + x; \
+	dst->y = vx * r.axisX.y + vy * r.axisY.y + vz * r.axisZ.y + y; \
+	dst->z = vx * r.axisX.z + vy * r.axisY.z + vz * r.axisZ.z + z;
+
+void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart* part, cc_bool head) {
+	struct Model* model        = Models.Active;
+	struct ModelVertex* src    = &model->vertices[part->offset];
+	struct VertexTextured* dst = &Models.Vertices[model->index];
+	struct VertexTextured* mesh;
+
+	float x = part->rotX, y = part->rotY, z = part->rotZ;
+	float vx, vy, vz;
+	struct PartRotation r;
+	struct ModelVertex v;
+	int i, count = part->count;
+
+	Model_CalcRotation(&r, angleX, angleY, angleZ, head);
+	mesh = ModelMesh_Get(part);
+
+	if (mesh) {
+		for (i = 0; i < count; i++, mesh++, dst++) 
+		{
+			vx = mesh->x - x; vy = mesh->y - y; vz = mesh->z - z;
+			Model_ApplyRotation(dst, vx, vy, vz);
+			dst->Col = Models.Cols[i >> 2];
+			dst->U   = mesh->U; dst->V = mesh->V;
+		}
+		model->index += count;
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		v = *src;
+		vx = v.x - x; vy = v.y - y; vz = v.z - z;
+		Model_ApplyRotation(dst, vx, vy, vz);
 		dst->Col = Models.Cols[i >> 2];
 
 		dst->U = (v.u & UV_POS_MASK) * Models.uScale - (v.u >> UV_MAX_SHIFT) * 0.01f * Models.uScale;
@@ -489,6 +650,7 @@ void Model_Unregister(struct Model* model) {
 	struct Model* cur;
 	int i;
 	LinkedList_Remove(model, cur, models_head, models_tail); 
+	ModelMesh_Invalidate(model);
 
 	/* unset this model from all entities, replacing with default fallback */
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
@@ -934,17 +1096,16 @@ struct ModelSet {
 #define HUMAN_BASE_VERTICES  (6 * MODEL_BOX_VERTICES)
 #define HUMAN_HAT32_VERTICES (1 * MODEL_BOX_VERTICES)
 #define HUMAN_HAT64_VERTICES (6 * MODEL_BOX_VERTICES)
-#define HUMAN_MAX_VERTICES   HUMAN_BASE_VERTICES + HUMAN_HAT64_VERTICES
+#define HUMAN_MAX_VERTICES   (HUMAN_BASE_VERTICES + HUMAN_HAT64_VERTICES)
 
-static void HumanModel_DrawCore(struct Entity* e, struct ModelSet* model, cc_bool opaqueBody) {
+#define HumanModel_NumVertices(type) (HUMAN_BASE_VERTICES + (type == SKIN_64x32 ? HUMAN_HAT32_VERTICES : HUMAN_HAT64_VERTICES))
+
+static void HumanModel_DrawParts(struct Entity* e, struct ModelSet* model) {
 	struct ModelLimbs* set;
-	int type, num;
-	Model_ApplyTexture(e);
+	int type;
 
 	type = Models.skinType;
 	set  = &model->limbs[type & 0x3];
-	num  = HUMAN_BASE_VERTICES + (type == SKIN_64x32 ? HUMAN_HAT32_VERTICES : HUMAN_HAT64_VERTICES);
-	Model_LockVB(e, num);
 
 	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &model->head, true);
 	Model_DrawPart(&model->torso);
@@ -967,6 +1128,15 @@ static void HumanModel_DrawCore(struct Entity* e, struct ModelSet* model, cc_boo
 		Models.Rotation = ROTATE_ORDER_ZYX;
 	}
 	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &model->hat, true);
+}
+
+static void HumanModel_DrawCore(struct Entity* e, struct ModelSet* model, cc_bool opaqueBody) {
+	int num;
+	Model_ApplyTexture(e);
+
+	num = HumanModel_NumVertices(Models.skinType);
+	Model_LockVB(e, num);
+	HumanModel_DrawParts(e, model);
 
 	Model_UnlockVB();
 	if (opaqueBody) {
@@ -1177,6 +1347,142 @@ static void HumanoidModel_Register(void) {
 }
 
 
+/*########################################################################################################################*
+*--------------------------------------------------------Model batching---------------------------------------------------*
+*#########################################################################################################################*/
+#ifndef CC_BUILD_CONSOLE
+/* Humanoid entities are usually the vast majority of entities, and most share the same few skins. */
+/* So instead of binding the skin and drawing each one separately, their vertices are transformed */
+/*  into world space on the CPU and then drawn together with just one texture bind per skin. */
+#define BATCH_MAX_ENTITIES 32
+#define BATCH_HATS_OFFSET  (BATCH_MAX_ENTITIES * HUMAN_BASE_VERTICES)
+#define BATCH_MAX_VERTICES (BATCH_MAX_ENTITIES * HUMAN_MAX_VERTICES)
+
+static struct Entity* batch_entities[ENTITIES_MAX_COUNT];
+static GfxResourceID batch_textures[ENTITIES_MAX_COUNT];
+static int batch_count;
+static cc_bool batch_active;
+static GfxResourceID batch_vb;
+static struct VertexTextured batch_vertices[HUMAN_MAX_VERTICES];
+
+static cc_bool Model_TryBatch(struct Model* model, struct Entity* e) {
+	if (!batch_active || model != &human_model || model->Draw != HumanModel_Draw) return false;
+	if (batch_count == ENTITIES_MAX_COUNT) return false;
+
+	batch_textures[batch_count] = Model_CalcTexture(model, e);
+	batch_entities[batch_count] = e;
+	batch_count++;
+	return true;
+}
+
+void Model_BeginBatch(void) {
+	batch_active = true;
+	batch_count  = 0;
+}
+
+/* Sorts the batched entities so that entities with the same skin are next to each other */
+static void Model_SortBatch(void) {
+	struct Entity* e; GfxResourceID tex;
+	int i, j;
+
+	for (i = 1; i < batch_count; i++) {
+		e = batch_entities[i]; tex = batch_textures[i];
+
+		for (j = i - 1; j >= 0 && (cc_uintptr)batch_textures[j] > (cc_uintptr)tex; j--) {
+			batch_entities[j + 1] = batch_entities[j];
+			batch_textures[j + 1] = batch_textures[j];
+		}
+		batch_entities[j + 1] = e; batch_textures[j + 1] = tex;
+	}
+}
+
+/* Transforms the vertices of the entity's model into world space */
+static void Model_TransformBatched(struct VertexTextured* dst, struct VertexTextured* src, int count, struct Matrix* m) {
+	float x, y, z;
+	int i;
+
+	for (i = 0; i < count; i++, src++, dst++) 
+	{
+		x = src->x; y = src->y; z = src->z;
+		*dst = *src;
+		dst->x = x * m->row1.x + y * m->row2.x + z * m->row3.x + m->row4.x;
+		dst->y = x * m->row1.y + y * m->row2.y + z * m->row3.y + m->row4.y;
+		dst->z = x * m->row1.z + y * m->row2.z + z * m->row3.z + m->row4.z;
+	}
+}
+
+/* Draws the given range of batched entities, which must all use the same skin */
+static void Model_DrawBatch(int beg, int end) {
+	struct VertexTextured* real = Models.Vertices;
+	struct VertexTextured* data;
+	struct Matrix transform;
+	struct Entity* e;
+	int i, num, bodyCount = 0, hatsCount = 0;
+
+	if (!batch_vb) batch_vb = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, BATCH_MAX_VERTICES);
+	if (!batch_vb) return;
+	data = (struct VertexTextured*)Gfx_LockDynamicVb(batch_vb, VERTEX_FORMAT_TEXTURED, BATCH_MAX_VERTICES);
+
+	for (i = beg; i < end; i++) 
+	{
+		e = batch_entities[i];
+		Model_SetupState(&human_model, e);
+		Model_CalcTexture(&human_model, e);
+
+		num = HumanModel_NumVertices(Models.skinType);
+		/* Should never happen, but don't write past the end of the vertex buffer */
+		if (BATCH_HATS_OFFSET + hatsCount + (num - HUMAN_BASE_VERTICES) > BATCH_MAX_VERTICES) break;
+		Models.Vertices = batch_vertices;
+		HumanModel_DrawParts(e, &human_set);
+		Model_GetEntityTransform(&human_model, e, &transform);
+
+		/* Body is drawn opaque, so goes in a separate range to the hat/layers */
+		Model_TransformBatched(&data[bodyCount], batch_vertices, HUMAN_BASE_VERTICES, &transform);
+		Model_TransformBatched(&data[BATCH_HATS_OFFSET + hatsCount], &batch_vertices[HUMAN_BASE_VERTICES], 
+								num - HUMAN_BASE_VERTICES, &transform);
+		bodyCount += HUMAN_BASE_VERTICES;
+		hatsCount += num - HUMAN_BASE_VERTICES;
+	}
+	Models.Vertices = real;
+	Gfx_UnlockDynamicVb(batch_vb);
+
+	/* human model draws the body opaque so players can't have invisible skins */
+	Gfx_SetAlphaTest(false);
+	Gfx_DrawVb_IndexedTris_Range(bodyCount, 0);
+	Gfx_SetAlphaTest(true);
+	Gfx_DrawVb_IndexedTris_Range(hatsCount, BATCH_HATS_OFFSET);
+}
+
+void Model_EndBatch(void) {
+	int beg, end;
+	batch_active = false;
+	if (!batch_count) return;
+
+	Model_SortBatch();
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+
+	for (beg = 0; beg < batch_count; beg = end) 
+	{
+		end = beg + 1;
+		while (end < batch_count && end - beg < BATCH_MAX_ENTITIES 
+			&& batch_textures[end] == batch_textures[beg]) end++;
+
+		Gfx_BindTexture(batch_textures[beg]);
+		Model_DrawBatch(beg, end);
+	}
+	batch_count = 0;
+}
+
+static void Model_FreeBatch(void) { Gfx_DeleteDynamicVb(&batch_vb); }
+#else
+/* Consoles draw from each entity's own VB, as the GPU may still be reading the previous contents */
+static cc_bool Model_TryBatch(struct Model* model, struct Entity* e) { return false; }
+void Model_BeginBatch(void) { }
+void Model_EndBatch(void)   { }
+static void Model_FreeBatch(void) { }
+#endif
+
+
 /*########################################################################################################################*
 *---------------------------------------------------------ChibiModel------------------------------------------------------*
 *#########################################################################################################################*/
@@ -2380,6 +2686,7 @@ static void HoldModel_Register(void) {
 *-------------------------------------------------------Models component--------------------------------------------------*
 *#########################################################################################################################*/
 static void RegisterDefaultModels(void) {
+	struct Model* model;
 	Model_RegisterTexture(&human_tex);
 	Model_RegisterTexture(&chicken_tex);
 	Model_RegisterTexture(&creeper_tex);
@@ -2411,11 +2718,18 @@ static void RegisterDefaultModels(void) {
 	CorpseModel_Register();
 	SkinnedCubeModel_Register();
 	HoldModel_Register();
+
+	/* Geometry of the built in models is never modified after being made */
+	for (model = models_head; model; model = model->next) 
+	{
+		model->flags |= MODEL_FLAG_STATIC_MESH;
+	}
 }
 
 static void OnContextLost(void* obj) {
 	struct ModelTex* tex;
 	Gfx_DeleteDynamicVb(&Models.Vb);
+	Model_FreeBatch();
 	if (Gfx.ManagedTextures) return;
 
 	for (tex = textures_head; tex; tex = tex->next) 
@@ -2436,6 +2750,7 @@ static void OnInit(void) {
 static void OnFree(void) {
 	OnContextLost(NULL);
 	CustomModel_FreeAll();
+	ModelMesh_FreeAll();
 }
 
 static void OnReset(void) { CustomModel_FreeAll(); }
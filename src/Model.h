@@ -41,6 +41,8 @@ struct ModelTex { const char* name; cc_uint8 skinType; GfxResourceID texID; stru
 
 #define MODEL_FLAG_INITED    0x01
 #define MODEL_FLAG_CLEAR_HAT 0x02
+/* Vertices are never modified after MakeParts, so can be cached in converted form */
+#define MODEL_FLAG_STATIC_MESH 0x04
 
 struct Model;
 /* Contains a set of quads and/or boxes that describe a 3D object as well as
@@ -130,6 +132,10 @@ cc_bool Model_ShouldRender(struct Entity* entity);
 float Model_RenderDistance(struct Entity* entity);
 /* Draws the given entity as the given model. */
 CC_API void Model_Render(struct Model* model, struct Entity* entity);
+/* Starts deferring Model_Render calls for entities which can be drawn together in batches */
+void Model_BeginBatch(void);
+/* Draws all entities deferred since Model_BeginBatch, grouped by skin texture */
+void Model_EndBatch(void);
 /* Sets up state to be suitable for rendering the given model. */
 /* NOTE: Model_Render already calls this, you don't normally need to call this. */
 CC_API void Model_SetupState(struct Model* model, struct Entity* entity);
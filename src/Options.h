@@ -85,6 +85,10 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_GAME_VERSION "game-version"
 #define OPT_INV_SCROLLBAR_SCALE "inv-scrollbar-scale"
 #define OPT_ANAGLYPH3D "anaglyph-3d"
+#define OPT_NET_CAPTURE "net-capture"
+#define OPT_NET_REPLAY "net-replay"
+#define OPT_NET_REPLAY_REALTIME "net-replay-realtime"
+#define OPT_NET_RECV_THREAD "net-recv-thread"
 
 #define OPT_SELECTED_BLOCK_OUTLINE_COLOR "selected-block-outline-color"
 #define OPT_SELECTED_BLOCK_OUTLINE_OPACITY "selected-block-outline-opacity"
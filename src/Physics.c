@@ -149,16 +149,53 @@ static void Searcher_QuickSort(int left, int right) {
 	}
 }
 
+/* Usually only a handful of blocks can be reached, in which case */
+/*  a simple insertion sort is faster than the overhead of quicksort */
+#define SEARCHER_INSERTION_SORT_MAX 24
+static void Searcher_InsertionSort(int count) {
+	struct SearcherState* keys = Searcher_States; struct SearcherState key;
+	int i, j;
+
+	for (i = 1; i < count; i++) {
+		key = keys[i];
+		for (j = i - 1; j >= 0 && keys[j].tSquared > key.tSquared; j--) {
+			keys[j + 1] = keys[j];
+		}
+		keys[j + 1] = key;
+	}
+}
+
+static struct SearcherState* Searcher_Add(struct SearcherState* curState, BlockID block, int x, int y, int z,
+										Vec3* vel, struct AABB* entityBB, struct AABB* entityExtentBB) {
+	struct AABB blockBB;
+	float xx, yy, zz, tx, ty, tz;
+
+	xx = (float)x; yy = (float)y; zz = (float)z;
+	blockBB.Min = Blocks.MinBB[block];
+	blockBB.Min.x += xx; blockBB.Min.y += yy; blockBB.Min.z += zz;
+	blockBB.Max = Blocks.MaxBB[block];
+	blockBB.Max.x += xx; blockBB.Max.y += yy; blockBB.Max.z += zz;
+
+	if (!AABB_Intersects(entityExtentBB, &blockBB)) return curState; /* necessary for non whole blocks. (slabs) */
+	Searcher_CalcTime(vel, entityBB, &blockBB, &tx, &ty, &tz);
+	if (tx > 1.0f || ty > 1.0f || tz > 1.0f) return curState;
+
+	curState->x = (x << 3) | (block  & 0x007);
+	curState->y = (y << 4) | ((block & 0x078) >> 3);
+	curState->z = (z << 3) | ((block & 0x380) >> 7);
+	curState->tSquared = tx * tx + ty * ty + tz * tz;
+	return curState + 1;
+}
+
 int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, struct AABB* entityExtentBB) {
 	Vec3 vel = entity->Velocity;
 	IVec3 min, max;
-	cc_uint32 elements;
+	cc_uint32 elements, capacity;
 	struct SearcherState* curState;
-	int count;
+	cc_bool rowInside;
+	int count, index;
 
 	BlockID block;
-	struct AABB blockBB;
-	float xx, yy, zz, tx, ty, tz;
 	int x, y, z;
 
 	Entity_GetBounds(entity, entityBB);
@@ -173,43 +210,52 @@ int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, s
 
 	IVec3_Floor(&min, &entityExtentBB->Min);
 	IVec3_Floor(&max, &entityExtentBB->Max);
+	/* Everything above the map is air, so can never be collided with */
+	max.y = min(max.y, World.Height - 1);
+	if (max.y < min.y) return 0;
 	elements = (max.x - min.x + 1) * (max.y - min.y + 1) * (max.z - min.z + 1);
 
 	if (elements > searcherCapacity) {
+		/* Grow geometrically, to avoid reallocating every tick when the search volume slowly grows */
+		/*  (e.g. when accelerating with speed hacks, or using giant collision sizes) */
+		/* NOTE: Must be calculated before Searcher_Free, which resets searcherCapacity */
+		capacity = max(elements, searcherCapacity * 2);
 		Searcher_Free();
-		searcherCapacity = elements;
-		Searcher_States  = (struct SearcherState*)Mem_Alloc(elements, sizeof(struct SearcherState), "collision search states");
+		searcherCapacity = capacity;
+		Searcher_States  = (struct SearcherState*)Mem_Alloc(searcherCapacity, sizeof(struct SearcherState), "collision search states");
 	}
 	curState = Searcher_States;
 
 	/* Order loops so that we minimise cache misses */
 	for (y = min.y; y <= max.y; y++) {
 		for (z = min.z; z <= max.z; z++) {
-			for (x = min.x; x <= max.x; x++) {
-				block = World_GetPhysicsBlock(x, y, z);
-				if (Blocks.Collide[block] != COLLIDE_SOLID) continue;
-
-				xx = (float)x; yy = (float)y; zz = (float)z;
-				blockBB.Min = Blocks.MinBB[block];
-				blockBB.Min.x += xx; blockBB.Min.y += yy; blockBB.Min.z += zz;
-				blockBB.Max = Blocks.MaxBB[block];
-				blockBB.Max.x += xx; blockBB.Max.y += yy; blockBB.Max.z += zz;
-
-				if (!AABB_Intersects(entityExtentBB, &blockBB)) continue; /* necessary for non whole blocks. (slabs) */
-				Searcher_CalcTime(&vel, entityBB, &blockBB, &tx, &ty, &tz);
-				if (tx > 1.0f || ty > 1.0f || tz > 1.0f) continue;
-
-				curState->x = (x << 3) | (block  & 0x007);
-				curState->y = (y << 4) | ((block & 0x078) >> 3);
-				curState->z = (z << 3) | ((block & 0x380) >> 7);
-				curState->tSquared = tx * tx + ty * ty + tz * tz;
-				curState++;
+			rowInside = y >= 0 && z >= 0 && z < World.Length && min.x >= 0 && max.x < World.Width;
+
+			/* Rows entirely inside the map can read blocks directly, without per block bounds checks */
+			if (rowInside) {
+				index = World_Pack(min.x, y, z);
+
+				for (x = min.x; x <= max.x; x++, index++) {
+					block = World_GetRawBlock(index);
+					if (Blocks.Collide[block] != COLLIDE_SOLID) continue;
+					curState = Searcher_Add(curState, block, x, y, z, &vel, entityBB, entityExtentBB);
+				}
+			} else {
+				for (x = min.x; x <= max.x; x++) {
+					block = World_GetPhysicsBlock(x, y, z);
+					if (Blocks.Collide[block] != COLLIDE_SOLID) continue;
+					curState = Searcher_Add(curState, block, x, y, z, &vel, entityBB, entityExtentBB);
+				}
 			}
 		}
 	}
 
 	count = (int)(curState - Searcher_States);
-	if (count) Searcher_QuickSort(0, count - 1);
+	if (count <= SEARCHER_INSERTION_SORT_MAX) {
+		Searcher_InsertionSort(count);
+	} else {
+		Searcher_QuickSort(0, count - 1);
+	}
 	return count;
 }
 
@@ -237,6 +237,8 @@ CC_API void Thread_Detach(void* handle);
 /* Blocks the current thread, until the given thread has finished. */
 /* NOTE: This cannot be used on a thread that has been detached. */
 CC_API void Thread_Join(void* handle);
+/* Returns the number of CPU cores that threads can run on at the same time. (1 if unknown) */
+int Thread_CpuCount(void);
 
 /* Allocates a new mutex. (used to synchronise access to a shared resource) */
 CC_API void* Mutex_Create(const char* name);
@@ -346,6 +346,8 @@ void Thread_Join(void* handle) {
 	// TODO
 }
 
+int Thread_CpuCount(void) { return 1; }
+
 void* Mutex_Create(const char* name) {
 	return NULL;
 }
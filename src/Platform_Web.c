@@ -229,6 +229,7 @@ cc_result File_Length(cc_file file, cc_uint32* len) {
 *#########################################################################################################################*/
 /* No real threading support with emscripten backend */
 void  Thread_Sleep(cc_uint32 milliseconds) { }
+int   Thread_CpuCount(void) { return 1; }
 
 void* Mutex_Create(const char* name) { return NULL; }
 void  Mutex_Free(void* handle) { }
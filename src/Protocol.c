@@ -18,6 +18,7 @@
 #include "Model.h"
 #include "Funcs.h"
 #include "Lighting.h"
+#include "MapRenderer.h"
 #include "Http.h"
 #include "Drawer2D.h"
 #include "Logger.h"
@@ -90,6 +91,7 @@ static struct CpeExt
 	pluginMessages_Ext  = { "PluginMessages", 1 },
 	extTeleport_Ext     = { "ExtEntityTeleport", 1 },
 	lightingMode_Ext    = { "LightingMode", 1 },
+	regionUpdate_Ext    = { "RegionBlockUpdate", 1 },
 	extTextures_Ext     = { "ExtendedTextures", 1 },
 	extBlocks_Ext       = { "ExtendedBlocks", 1 };
 
@@ -99,7 +101,7 @@ static struct CpeExt* cpe_clientExtensions[] = {
 	&messageTypes_Ext, &hackControl_Ext, &playerClick_Ext, &fullCP437_Ext, &longerMessages_Ext, &blockDefs_Ext,
 	&blockDefsExt_Ext, &bulkBlockUpdate_Ext, &textColors_Ext, &envMapAspect_Ext, &entityProperty_Ext, &extEntityPos_Ext,
 	&twoWayPing_Ext, &invOrder_Ext, &instantMOTD_Ext, &fastMap_Ext, &setHotbar_Ext, &setSpawnpoint_Ext, &velControl_Ext,
-	&customParticles_Ext, &pluginMessages_Ext, &extTeleport_Ext, &lightingMode_Ext,
+	&customParticles_Ext, &pluginMessages_Ext, &extTeleport_Ext, &lightingMode_Ext, &regionUpdate_Ext,
 #ifdef CUSTOM_MODELS
 	&customModels_Ext,
 #endif
@@ -409,11 +411,8 @@ static cc_result MapState_Read(struct MapState* m) {
 	if (!m->blocks) {
 		m->blocks = (BlockRaw*)Mem_TryAlloc(map_volume, 1);
 		/* unlikely but possible */
-		if (!m->blocks) {
-			Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
-			m->allocFailed = true;
-			return 0;
-		}
+		/* NOTE: Can be called from map decompression thread, so dialog is shown later */
+		if (!m->blocks) { m->allocFailed = true; return 0; }
 	}
 
 	left = map_volume - m->index;
@@ -423,6 +422,221 @@ static cc_result MapState_Read(struct MapState* m) {
 	return res;
 }
 
+/* Decompresses a chunk of map data sent by the server */
+static cc_result MapState_Process(struct MapState* m, cc_uint8* data, int length) {
+	cc_result res;
+	map_part.meta.mem.cur    = data;
+	map_part.meta.mem.base   = data;
+	map_part.meta.mem.left   = length;
+	map_part.meta.mem.length = length;
+
+	if (!m->gzHeader.done) {
+		res = GZipHeader_Read(&map_part, &m->gzHeader);
+		if (res && res != ERR_END_OF_STREAM) return res;
+	}
+
+	if (m->gzHeader.done) return MapState_Read(m);
+	return 0;
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Map queue---------------------------------------------------------*
+*#########################################################################################################################*/
+/* Map data chunks are decompressed on a separate thread, so that the network tick */
+/*  only has to copy the data from each LevelDataChunk packet into the queue */
+#define MAP_CHUNK_SIZE 1024
+/* Maximum number of chunks waiting to be decompressed (1 MB of compressed data) */
+/* When the queue is full, the network tick waits for the worker to catch up */
+#define MAP_QUEUE_MAX_CHUNKS 1024
+struct MapChunk { cc_uint8 data[MAP_CHUNK_SIZE]; int length; cc_bool upper; };
+
+static cc_result map_error;
+static int map_decoded, map_decodedVolume;
+
+static struct MapState* MapQueue_GetState(cc_bool upper) {
+#ifdef EXTENDED_BLOCKS
+	if (upper) return &map2;
+#endif
+	return &map1;
+}
+
+#ifdef CC_BUILD_COOPTHREADED
+/* No point using a separate thread, just decompress the chunk immediately */
+static void MapQueue_Add(cc_uint8* data, int length, cc_bool upper) {
+	if (!map_error) map_error = MapState_Process(MapQueue_GetState(upper), data, length);
+	map_decoded = map1.index;
+}
+
+static void MapQueue_Finish(void) { }
+static void MapQueue_Abort(void)  { map_error = 0; map_decoded = 0; }
+static int MapQueue_GetDecoded(cc_result* res, int* volume) { *res = map_error; *volume = map_volume; return map_decoded; }
+static void MapQueue_Free(void) { }
+#else
+static struct MapChunk* mapQueue;
+static int mapQueueHead, mapQueueCount, mapQueueCapacity;
+static cc_bool map_finishing;
+static void* map_thread;
+static void* map_mutex;
+static void* map_waitable;
+
+static void MapQueue_WorkerLoop(void) {
+	struct MapChunk chunk;
+	cc_bool hasChunk, finishing;
+	cc_result res = 0;
+	int decoded, volume;
+
+	for (;;) {
+		Mutex_Lock(map_mutex);
+		{
+			hasChunk  = mapQueueCount > 0;
+			finishing = map_finishing;
+
+			if (hasChunk) {
+				chunk = mapQueue[mapQueueHead];
+				mapQueueHead = (mapQueueHead + 1) % mapQueueCapacity;
+				mapQueueCount--;
+			}
+		}
+		Mutex_Unlock(map_mutex);
+
+		if (!hasChunk) {
+			/* Only stop once all the queued chunks have been decompressed */
+			if (finishing) return;
+			Waitable_Wait(map_waitable);
+			continue;
+		}
+
+		/* After an error, just discard any remaining chunks */
+		if (!res) res = MapState_Process(MapQueue_GetState(chunk.upper), chunk.data, chunk.length);
+		decoded = map1.index;
+		/* map_volume might have just been read from the map data by this thread */
+		volume  = map_volume;
+
+		Mutex_Lock(map_mutex);
+		{
+			map_error   = res;
+			map_decoded = decoded;
+			map_decodedVolume = volume;
+		}
+		Mutex_Unlock(map_mutex);
+	}
+}
+
+/* Increases capacity of the queue, keeping the chunks in order */
+static cc_bool MapQueue_Grow(void) {
+	struct MapChunk* chunks;
+	int i, capacity = max(32, mapQueueCapacity * 2);
+	if (mapQueueCapacity >= MAP_QUEUE_MAX_CHUNKS) return false;
+	capacity = min(capacity, MAP_QUEUE_MAX_CHUNKS);
+
+	chunks = (struct MapChunk*)Mem_TryAlloc(capacity, sizeof(struct MapChunk));
+	if (!chunks) return false;
+
+	for (i = 0; i < mapQueueCount; i++) 
+	{
+		chunks[i] = mapQueue[(mapQueueHead + i) % mapQueueCapacity];
+	}
+	Mem_Free(mapQueue);
+
+	mapQueue         = chunks;
+	mapQueueHead     = 0;
+	mapQueueCapacity = capacity;
+	return true;
+}
+
+static void MapQueue_Add(cc_uint8* data, int length, cc_bool upper) {
+	struct MapChunk* chunk;
+	cc_bool added = false;
+
+	if (!map_mutex) {
+		map_mutex    = Mutex_Create("Map queue");
+		map_waitable = Waitable_Create("Map queue wakeup");
+	}
+	if (!map_thread) {
+		map_finishing = false;
+		Thread_Run(&map_thread, MapQueue_WorkerLoop, 128 * 1024, "Map decompress");
+	}
+
+	while (!added) {
+		Mutex_Lock(map_mutex);
+		{
+			if (mapQueueCount < mapQueueCapacity || MapQueue_Grow()) {
+				chunk = &mapQueue[(mapQueueHead + mapQueueCount) % mapQueueCapacity];
+				Mem_Copy(chunk->data, data, length);
+				chunk->length = length;
+				chunk->upper  = upper;
+
+				mapQueueCount++;
+				added = true;
+			}
+		}
+		Mutex_Unlock(map_mutex);
+
+		/* Queue is full (or out of memory), wait for worker to free up space */
+		if (!added) Thread_Sleep(1);
+	}
+	Waitable_Signal(map_waitable);
+}
+
+/* Blocks until all queued chunks have been decompressed */
+static void MapQueue_Finish(void) {
+	if (!map_thread) return;
+	Mutex_Lock(map_mutex);
+	{
+		map_finishing = true;
+	}
+	Mutex_Unlock(map_mutex);
+
+	Waitable_Signal(map_waitable);
+	Thread_Join(map_thread);
+	map_thread = NULL;
+}
+
+/* Stops decompressing, discarding any queued chunks */
+static void MapQueue_Abort(void) {
+	if (map_mutex) {
+		Mutex_Lock(map_mutex);
+		{
+			mapQueueCount = 0;
+		}
+		Mutex_Unlock(map_mutex);
+	}
+
+	MapQueue_Finish();
+	map_error   = 0;
+	map_decoded = 0;
+	map_decodedVolume = 0;
+}
+
+/* NOTE: volume is 0 until the worker has read it from the map data (unless using FastMap) */
+static int MapQueue_GetDecoded(cc_result* res, int* volume) {
+	int decoded;
+	if (!map_thread) { *res = map_error; *volume = map_volume; return map_decoded; }
+
+	Mutex_Lock(map_mutex);
+	{
+		*res    = map_error;
+		*volume = map_decodedVolume;
+		decoded = map_decoded;
+	}
+	Mutex_Unlock(map_mutex);
+	return decoded;
+}
+
+static void MapQueue_Free(void) {
+	Mem_Free(mapQueue);
+	mapQueue         = NULL;
+	mapQueueCapacity = 0;
+
+	if (!map_mutex) return;
+	Mutex_Free(map_mutex);
+	Waitable_Free(map_waitable);
+	map_mutex    = NULL;
+	map_waitable = NULL;
+}
+#endif
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Classic protocol-----------------------------------------------------*
@@ -529,6 +743,7 @@ static void Classic_StartLoading(void) {
 	WoM_CheckMotd();
 	classic_receivedFirstPos = false;
 
+	MapQueue_Abort();
 	map_begunLoading = true;
 	map_receiveBeg   = Stopwatch_Measure();
 	map_volume       = 0;
@@ -555,50 +770,41 @@ static void Classic_LevelInit(cc_uint8* data) {
 }
 
 static void Classic_LevelDataChunk(cc_uint8* data) {
-	struct MapState* m;
-	int usedLength;
+	int usedLength, decoded, volume;
+	cc_bool upper = false;
 	float progress;
 	cc_result res;
 
 	/* Workaround for some servers that send LevelDataChunk before LevelInit due to their async sending behaviour */
 	if (!map_begunLoading) Classic_StartLoading();
 	usedLength = Stream_GetU16_BE(data);
+	usedLength = min(usedLength, MAP_CHUNK_SIZE);
 
-	map_part.meta.mem.cur    = data + 2;
-	map_part.meta.mem.base   = data + 2;
-	map_part.meta.mem.left   = usedLength;
-	map_part.meta.mem.length = usedLength;
-
-#ifndef EXTENDED_BLOCKS
-	m = &map1;
-#else
+#ifdef EXTENDED_BLOCKS
 	/* progress byte in original classic, but we ignore it */
-	if (IsSupported(extBlocks_Ext) && data[1026]) {
-		m = &map2;
-	} else {
-		m = &map1;
-	}
+	upper = IsSupported(extBlocks_Ext) && data[1026];
 #endif
+	MapQueue_Add(data + 2, usedLength, upper);
 
-	if (!m->gzHeader.done) {
-		res = GZipHeader_Read(&map_part, &m->gzHeader);
-		if (res && res != ERR_END_OF_STREAM) { DisconnectInvalidMap(res); return; }
-	}
-
-	if (m->gzHeader.done) {
-		res = MapState_Read(m);
-		if (res) { DisconnectInvalidMap(res); return; }
-	}
+	/* Errors are only noticed after the chunk that caused them has been decompressed */
+	decoded = MapQueue_GetDecoded(&res, &volume);
+	if (res) { MapQueue_Abort(); DisconnectInvalidMap(res); return; }
 
-	progress = !map_volume ? 0.0f : (float)map1.index / map_volume;
+	progress = !volume ? 0.0f : (float)decoded / volume;
 	Event_RaiseFloat(&WorldEvents.Loading, progress);
 }
 
 static void Classic_LevelFinalise(cc_uint8* data) {
 	int width, height, length, volume;
 	cc_uint64 end;
+	cc_result res;
 	int delta;
 
+	/* Wait for any remaining map data to be decompressed */
+	MapQueue_Finish();
+	MapQueue_GetDecoded(&res, &volume);
+	if (res) { MapQueue_Abort(); DisconnectInvalidMap(res); return; }
+
 	end   = Stopwatch_Measure();
 	delta = Stopwatch_ElapsedMS(map_receiveBeg, end);
 	Platform_Log1("map loading took: %i", &delta);
@@ -607,6 +813,8 @@ static void Classic_LevelFinalise(cc_uint8* data) {
 
 #ifdef EXTENDED_BLOCKS
 	if (map2.allocFailed) FreeMapStates();
+	if (map2.allocFailed && !map1.allocFailed)
+		Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
 #endif
 
 	width  = Stream_GetU16_BE(data + 0);
@@ -615,6 +823,7 @@ static void Classic_LevelFinalise(cc_uint8* data) {
 	volume = width * height * length;
 
 	if (map1.allocFailed) {
+		Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
 		Chat_AddRaw("&cFailed to load map, try joining a different map");
 		Chat_AddRaw("   &cNot enough free memory to load the map");
 	} else if (!map1.blocks) {
@@ -1030,6 +1239,7 @@ static void CPE_ExtEntry(cc_uint8* data) {
 		Protocol.Sizes[OPCODE_SET_INVENTORY_ORDER] += 2;
 		Protocol.Sizes[OPCODE_BULK_BLOCK_UPDATE]   += 256 / 4;
 		Protocol.Sizes[OPCODE_SET_HOTBAR]       += 1;
+		Protocol.Sizes[OPCODE_REGION_FILL]      += 1;
 	}
 #endif
 }
@@ -1288,6 +1498,134 @@ static void CPE_BulkBlockUpdate(cc_uint8* data) {
 	}
 }
 
+/* RegionBlockUpdate lets the server change all the blocks in a cuboid region using either: */
+/*   RegionFill  - fills the entire region with one block */
+/*   RegionBegin - followed by RegionData packets containing the deflate compressed blocks of */
+/*                 the region in YZX order, then the upper 8 bits of each block with ExtendedBlocks */
+#define REGION_CHUNK_SIZE 1024
+static struct RegionState {
+	struct InflateState inflateState;
+	struct Stream stream, part;
+	BlockRaw* blocks;
+	int x, y, z, width, height, length;
+	cc_uint32 index, total;
+} region;
+
+static void Region_Free(void) {
+	Mem_Free(region.blocks);
+	region.blocks = NULL;
+}
+
+/* Clamps the given region to the bounds of the world, returning false if outside the world */
+static cc_bool Region_Clamp(int* x1, int* y1, int* z1, int* x2, int* y2, int* z2) {
+	*x1 = max(*x1, 0); *x2 = min(*x2, World.MaxX);
+	*y1 = max(*y1, 0); *y2 = min(*y2, World.MaxY);
+	*z1 = max(*z1, 0); *z2 = min(*z2, World.MaxZ);
+	return *x1 <= *x2 && *y1 <= *y2 && *z1 <= *z2;
+}
+
+static void Region_Apply(void) {
+	int x1 = region.x, x2 = region.x + region.width  - 1;
+	int y1 = region.y, y2 = region.y + region.height - 1;
+	int z1 = region.z, z2 = region.z + region.length - 1;
+	cc_uint32 volume = region.total;
+	cc_bool changed  = false;
+	cc_uint32 i;
+	BlockID block;
+	int x, y, z;
+
+	if (IsSupported(extBlocks_Ext)) volume /= 2;
+	if (!Region_Clamp(&x1, &y1, &z1, &x2, &y2, &z2)) return;
+
+	for (y = y1; y <= y2; y++) {
+		for (z = z1; z <= z2; z++) {
+			i = ((y - region.y) * region.length + (z - region.z)) * region.width + (x1 - region.x);
+
+			for (x = x1; x <= x2; x++, i++) {
+				block = region.blocks[i];
+#ifdef EXTENDED_BLOCKS
+				if (volume != region.total) block |= (BlockID)(region.blocks[volume + i] << 8);
+				block %= BLOCK_COUNT;
+#endif
+				changed |= Game_UpdateBlockState(x, y, z, block);
+			}
+		}
+	}
+	if (changed) MapRenderer_RefreshRegion(x1, y1, z1, x2, y2, z2);
+}
+
+static void CPE_RegionFill(cc_uint8* data) {
+	int x1 = Stream_GetU16_BE(data + 0), x2 = Stream_GetU16_BE(data +  6);
+	int y1 = Stream_GetU16_BE(data + 2), y2 = Stream_GetU16_BE(data +  8);
+	int z1 = Stream_GetU16_BE(data + 4), z2 = Stream_GetU16_BE(data + 10);
+	cc_bool changed = false;
+	BlockID block;
+	int x, y, z;
+
+	data += 12;
+	ReadBlock(data, block);
+	if (!Region_Clamp(&x1, &y1, &z1, &x2, &y2, &z2)) return;
+
+	for (y = y1; y <= y2; y++) {
+		for (z = z1; z <= z2; z++) {
+			for (x = x1; x <= x2; x++) {
+				changed |= Game_UpdateBlockState(x, y, z, block);
+			}
+		}
+	}
+	if (changed) MapRenderer_RefreshRegion(x1, y1, z1, x2, y2, z2);
+}
+
+static void CPE_RegionBegin(cc_uint8* data) {
+	cc_uint32 volume;
+	Region_Free();
+
+	region.x      = Stream_GetU16_BE(data + 0);
+	region.y      = Stream_GetU16_BE(data + 2);
+	region.z      = Stream_GetU16_BE(data + 4);
+	region.width  = Stream_GetU16_BE(data + 6);
+	region.height = Stream_GetU16_BE(data + 8);
+	region.length = Stream_GetU16_BE(data + 10);
+
+	/* Region data is ignored when it is larger than the world */
+	/* NOTE: Must check each axis, as width * height * length of 3 U16s can overflow */
+	if (region.width  > World.Width)  return;
+	if (region.height > World.Height) return;
+	if (region.length > World.Length) return;
+
+	volume = (cc_uint32)region.width * region.height * region.length;
+	if (!volume) return;
+
+	region.index = 0;
+	region.total = IsSupported(extBlocks_Ext) ? volume * 2 : volume;
+	region.blocks = (BlockRaw*)Mem_TryAlloc(region.total, 1);
+	if (!region.blocks) { Platform_LogConst("Out of memory for region block update"); return; }
+
+	Stream_ReadonlyMemory(&region.part, NULL, 0);
+	Inflate_MakeStream2(&region.stream, &region.inflateState, &region.part);
+}
+
+static void CPE_RegionData(cc_uint8* data) {
+	int length = Stream_GetU16_BE(data);
+	cc_uint32 read;
+	cc_result res;
+	if (!region.blocks) return;
+
+	length = min(length, REGION_CHUNK_SIZE);
+	Stream_ReadonlyMemory(&region.part, data + 2, length);
+
+	res = region.stream.Read(&region.stream, &region.blocks[region.index], region.total - region.index, &read);
+	region.index += read;
+
+	if (res) {
+		Logger_SysWarn(res, "decompressing region block update");
+		Region_Free();
+	} else if (region.index == region.total) {
+		Region_Apply();
+		Region_Free();
+	}
+}
+
 static void CPE_SetTextColor(cc_uint8* data) {
 	BitmapCol c   = BitmapCol_Make(data[0], data[1], data[2], data[3]);
 	cc_uint8 code = data[4];
@@ -1558,6 +1896,7 @@ static void CPE_LightingMode(cc_uint8* data) {
 
 static void CPE_Reset(void) {
 	cpe_serverExtensionsCount = 0; cpe_pingTicks = 0;
+	Region_Free();
 	CPEExtensions_Reset();
 	cpe_needD3Fix = false;
 	Game_UseCPEBlocks = false;
@@ -1599,6 +1938,9 @@ static void CPE_Reset(void) {
 	Net_Set(OPCODE_PLUGIN_MESSAGE, CPE_PluginMessage, 66);
 	Net_Set(OPCODE_ENTITY_TELEPORT_EXT, CPE_ExtEntityTeleport, 11);
 	Net_Set(OPCODE_LIGHTING_MODE, CPE_LightingMode, 3);
+	Net_Set(OPCODE_REGION_FILL, CPE_RegionFill, 14);
+	Net_Set(OPCODE_REGION_BEGIN, CPE_RegionBegin, 13);
+	Net_Set(OPCODE_REGION_DATA, CPE_RegionData, 3 + REGION_CHUNK_SIZE);
 }
 
 static cc_uint8* CPE_Tick(cc_uint8* data) {
@@ -1913,8 +2255,16 @@ static void OnInit(void) {
 static void OnReset(void) {
 	if (Server.IsSinglePlayer) return;
 	Mem_Set(&Protocol, 0, sizeof(Protocol));
+	MapQueue_Abort();
 	Protocol_Reset();
 	FreeMapStates();
+	MapQueue_Free();
+}
+
+static void OnFree(void) {
+	MapQueue_Abort();
+	FreeMapStates();
+	MapQueue_Free();
 }
 #else
 void CPE_SendPlayerClick(int button, cc_bool pressed, cc_uint8 targetId, struct RayTracer* t) { }
@@ -1922,10 +2272,11 @@ void CPE_SendPlayerClick(int button, cc_bool pressed, cc_uint8 targetId, struct
 static void OnInit(void) { }
 
 static void OnReset(void) { }
+static void OnFree(void)  { }
 #endif
 
 struct IGameComponent Protocol_Component = {
 	OnInit,  /* Init  */
-	NULL,    /* Free  */
+	OnFree,  /* Free  */
 	OnReset, /* Reset */
 };
@@ -40,6 +40,7 @@ enum OPCODE_ {
 	OPCODE_DEFINE_MODEL, OPCODE_DEFINE_MODEL_PART, OPCODE_UNDEFINE_MODEL,
 	OPCODE_PLUGIN_MESSAGE, OPCODE_ENTITY_TELEPORT_EXT,
 	OPCODE_LIGHTING_MODE,
+	OPCODE_REGION_FILL, OPCODE_REGION_BEGIN, OPCODE_REGION_DATA,
 
 	OPCODE_COUNT
 };
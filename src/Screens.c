@@ -78,6 +78,8 @@ static struct HUDScreen {
 	int lastFov;
 	int lastX, lastY, lastZ;
 	struct HotbarWidget hotbar;
+	cc_uint32 lastNetPackets, lastNetBytes;
+	cc_uint64 lastNetTimes[256];
 } HUDScreen_Instance;
 
 /* Each integer can be at most 10 digits + minus prefix */
@@ -86,6 +88,40 @@ static struct HUDScreen {
 #define POSITION_HUD_CHARS (1 + 1 + POSITION_VAL_CHARS + 1 + POSITION_VAL_CHARS + 1 + POSITION_VAL_CHARS + 1)
 #define HUD_MAX_VERTICES (4 + TEXTWIDGET_MAX * 2 + HOTBAR_MAX_VERTICES + POSITION_HUD_CHARS * 4)
 
+/* Appends rate of received packets since last call, and the opcode whose handlers took the most time */
+static void HUDScreen_AppendNetStats(struct HUDScreen* s, cc_string* status) {
+	cc_uint32 packets = 0, bytes = 0;
+	cc_uint64 time, maxTime = 0;
+	int i, rate, kbRate, maxUS;
+	cc_uint8 maxOpcode = 0;
+
+	for (i = 0; i < 256; i++) 
+	{
+		packets += NetStats.Recv[i].count;
+		bytes   += NetStats.Recv[i].bytes;
+
+		/* Stats are reset to 0 when connecting to a new server */
+		time = NetStats.Recv[i].handlerTime;
+		if (time >= s->lastNetTimes[i]) time -= s->lastNetTimes[i];
+		s->lastNetTimes[i] = NetStats.Recv[i].handlerTime;
+
+		if (time <= maxTime) continue;
+		maxTime = time; maxOpcode = (cc_uint8)i;
+	}
+
+	if (packets < s->lastNetPackets) s->lastNetPackets = 0;
+	if (bytes   < s->lastNetBytes)   s->lastNetBytes   = 0;
+	rate   = (int)((packets - s->lastNetPackets) / s->accumulator);
+	kbRate = (int)((bytes   - s->lastNetBytes)   / s->accumulator / 1024);
+	s->lastNetPackets = packets;
+	s->lastNetBytes   = bytes;
+
+	String_Format2(status, ", %i packets/s, %i KB/s", &rate, &kbRate);
+	if (!maxTime) return;
+	maxUS = (int)maxTime;
+	String_Format2(status, " (opcode %b: %i us)", &maxOpcode, &maxUS);
+}
+
 static void HUDScreen_RemakeLine1(struct HUDScreen* s) {
 	cc_string status; char statusBuffer[STRING_SIZE * 2];
 	int indices, ping, fps;
@@ -119,6 +155,7 @@ static void HUDScreen_RemakeLine1(struct HUDScreen* s) {
 
 		ping = Ping_AveragePingMS();
 		if (ping) String_Format1(&status, ", ping %i ms", &ping);
+		if (NetStats.ShowInHUD && s->accumulator) HUDScreen_AppendNetStats(s, &status);
 	}
 	TextWidget_Set(&s->line1, &status, &s->font);
 	s->dirty = true;
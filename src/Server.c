@@ -25,6 +25,8 @@
 #include "Input.h"
 #include "Errors.h"
 #include "Options.h"
+#include "Stream.h"
+#include "Utils.h"
 
 static char nameBuffer[STRING_SIZE];
 static char motdBuffer[STRING_SIZE];
@@ -110,6 +112,17 @@ static void Ping_Reset(void) {
 }
 
 
+/*########################################################################################################################*
+*--------------------------------------------------------NetStats---------------------------------------------------------*
+*#########################################################################################################################*/
+struct _NetStatsData NetStats;
+
+void NetStats_Reset(void) {
+	Mem_Set(NetStats.Recv, 0, sizeof(NetStats.Recv));
+	Mem_Set(NetStats.Sent, 0, sizeof(NetStats.Sent));
+}
+
+
 /*########################################################################################################################*
 *-------------------------------------------------Singleplayer connection-------------------------------------------------*
 *#########################################################################################################################*/
@@ -234,8 +247,17 @@ static cc_result net_writeFailure;
 static void OnClose(void);
 
 #ifdef CC_BUILD_NETWORKING
-static cc_uint8  net_readBuffer[4096 * 5];
-static cc_uint8* net_readCurrent;
+/* Received data is stored in a circular buffer and parsed in place */
+/* Packets which wrap around the end of the buffer have their start copied */
+/*  into the extra space after the end, so that handlers always see a contiguous packet */
+#define NET_READ_SIZE  (4096 * 8)
+#define NET_MAX_PACKET 4096
+static cc_uint8 net_readBuffer[NET_READ_SIZE + NET_MAX_PACKET];
+static cc_uint32 net_readHead, net_readCount;
+/* Packets sent during a tick are combined and sent together at the end of the tick */
+#define NET_WRITE_SIZE (4096 * 4)
+static cc_uint8 net_writeBuffer[NET_WRITE_SIZE];
+static cc_uint32 net_writeCount;
 static double net_lastPacket;
 static cc_uint8 lastOpcode;
 
@@ -243,13 +265,274 @@ static cc_bool net_connecting;
 static double net_connectTimeout;
 #define NET_TIMEOUT_SECS 15
 
+
+/*########################################################################################################################*
+*--------------------------------------------------Packet capture/replay--------------------------------------------------*
+*#########################################################################################################################*/
+/* Capture files consist of a sequence of records, each of which is: */
+/*   u32 BE milliseconds since connecting, u32 BE data length, then the data as received from the socket */
+#define NET_RECORD_HEADER_SIZE 8
+static struct Stream net_capture;
+static cc_bool net_capturing;
+static cc_uint64 net_captureBeg;
+
+static void NetCapture_Open(void) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	struct DateTime now;
+	cc_result res;
+	if (!Options_GetBool(OPT_NET_CAPTURE, false)) return;
+	if (!Utils_EnsureDirectory("captures")) return;
+
+	DateTime_CurrentLocal(&now);
+	String_InitArray(path, pathBuffer);
+	String_Format3(&path, "captures/%p4-%p2-%p2", &now.year, &now.month, &now.day);
+	String_Format3(&path, " %p2-%p2-%p2.bin", &now.hour, &now.minute, &now.second);
+
+	res = Stream_CreateFile(&net_capture, &path);
+	if (res) { Logger_SysWarn2(res, "creating", &path); return; }
+
+	net_capturing  = true;
+	net_captureBeg = Stopwatch_Measure();
+}
+
+static void NetCapture_Close(void) {
+	if (!net_capturing) return;
+	net_capture.Close(&net_capture);
+	net_capturing = false;
+}
+
+static void NetCapture_Write(const cc_uint8* data, cc_uint32 len) {
+	cc_uint8 header[NET_RECORD_HEADER_SIZE];
+	cc_uint64 now;
+	cc_result res;
+	if (!net_capturing) return;
+
+	now = Stopwatch_Measure();
+	Stream_SetU32_BE(header + 0, Stopwatch_ElapsedMS(net_captureBeg, now));
+	Stream_SetU32_BE(header + 4, len);
+
+	if ((res = Stream_Write(&net_capture, header, NET_RECORD_HEADER_SIZE)) ||
+		(res = Stream_Write(&net_capture, data, len))) {
+		Logger_SysWarn(res, "writing to packet capture");
+		NetCapture_Close();
+	}
+}
+
+/* Replays a capture file in place of reading from a socket, either as fast as */
+/*  possible (for benchmarking packet handling) or with the original timing */
+static struct Stream net_replay, net_replayFile;
+static cc_uint8 net_replayBuffer[16384];
+static cc_bool net_replaying, net_replayRealtime, net_replayDone;
+static cc_uint32 net_replayTime, net_replayLeft;
+static cc_uint64 net_replayBeg;
+
+static cc_bool NetReplay_Open(void) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_result res;
+	String_InitArray(path, pathBuffer);
+	if (!Options_UNSAFE_Get(OPT_NET_REPLAY, &path)) return false;
+
+	res = Stream_OpenFile(&net_replayFile, &path);
+	if (res) { Logger_SysWarn2(res, "opening", &path); return false; }
+	Stream_ReadonlyBuffered(&net_replay, &net_replayFile, net_replayBuffer, sizeof(net_replayBuffer));
+
+	net_replaying      = true;
+	net_replayRealtime = Options_GetBool(OPT_NET_REPLAY_REALTIME, false);
+	net_replayDone     = false;
+	net_replayLeft     = 0;
+
+	net_replayBeg = Stopwatch_Measure();
+	return true;
+}
+
+static void NetReplay_Close(void) {
+	if (!net_replaying) return;
+	/* File is already closed once the end of the capture is reached */
+	if (!net_replayDone) net_replayFile.Close(&net_replayFile);
+	net_replaying = false;
+}
+
+static void NetReplay_Report(void) {
+	cc_uint64 end = Stopwatch_Measure();
+	int elapsedMS = Stopwatch_ElapsedMS(net_replayBeg, end);
+	int i, rate, packets = 0, handlerMS;
+	cc_uint64 handlerTime = 0;
+	cc_uint8 opcode;
+	float avg;
+
+	for (i = 0; i < 256; i++) 
+	{
+		packets     += NetStats.Recv[i].count;
+		handlerTime += NetStats.Recv[i].handlerTime;
+	}
+	handlerMS = (int)(handlerTime / 1000);
+
+	rate = elapsedMS ? (int)((cc_uint64)packets * 1000 / elapsedMS) : 0;
+	Chat_Add3("&eReplayed %i packets in %i ms (%i packets/sec)", &packets, &elapsedMS, &rate);
+	Chat_Add1("&e  Time spent in packet handlers: %i ms", &handlerMS);
+
+	for (i = 0; i < 256; i++) 
+	{
+		if (!NetStats.Recv[i].count) continue;
+		opcode  = (cc_uint8)i;
+		packets = NetStats.Recv[i].count;
+		avg     = (float)NetStats.Recv[i].handlerTime / packets;
+		Chat_Add3("&e  Opcode %b: %i packets, %f2 us avg", &opcode, &packets, &avg);
+	}
+}
+
+/* Reads data of the next record(s) in the capture */
+static cc_result NetReplay_Read(cc_uint8* data, cc_uint32 count, cc_uint32* read) {
+	cc_uint8 header[NET_RECORD_HEADER_SIZE];
+	cc_uint64 now;
+	cc_result res;
+	*read = 0;
+
+	if (!net_replayLeft) {
+		res = Stream_Read(&net_replay, header, NET_RECORD_HEADER_SIZE);
+		if (res == ERR_END_OF_STREAM) { net_replayDone = true; return 0; }
+		if (res) return res;
+
+		net_replayTime = Stream_GetU32_BE(header + 0);
+		net_replayLeft = Stream_GetU32_BE(header + 4);
+	}
+
+	if (net_replayRealtime) {
+		now = Stopwatch_Measure();
+		if ((cc_uint32)Stopwatch_ElapsedMS(net_replayBeg, now) < net_replayTime) return 0;
+	}
+
+	count = min(count, net_replayLeft);
+	res   = Stream_Read(&net_replay, data, count);
+	if (res) return res;
+
+	net_replayLeft -= count;
+	*read = count;
+	return 0;
+}
+
+
+/* Optionally, data can be received from the socket on a separate thread, */
+/*  which reads into a queue that the main thread then drains every network tick */
+#ifndef CC_BUILD_COOPTHREADED
+#define NET_RECV_SIZE (64 * 1024)
+/* Maximum number of reads from the receive queue per network tick */
+#define NET_RECV_MAX_DRAINS 8
+static cc_uint8 net_recvBuffer[NET_RECV_SIZE];
+static cc_uint32 net_recvHead, net_recvCount;
+static cc_bool net_recvThreaded;
+static volatile cc_bool net_recvStop;
+static volatile cc_result net_recvError;
+static void* net_recvMutex;
+static void* net_recvThread;
+
+static void NetRecv_ThreadLoop(void) {
+	cc_uint32 tail, avail, read;
+	cc_result res;
+
+	while (!net_recvStop) 
+	{
+		Mutex_Lock(net_recvMutex);
+		{
+			tail  = (net_recvHead + net_recvCount) % NET_RECV_SIZE;
+			avail = min(NET_RECV_SIZE - tail, NET_RECV_SIZE - net_recvCount);
+		}
+		Mutex_Unlock(net_recvMutex);
+
+		/* Queue is full, wait for the main thread to process some of the data */
+		if (!avail) { Thread_Sleep(1); continue; }
+		res = Socket_Read(net_socket, &net_recvBuffer[tail], avail, &read);
+
+		if (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock) {
+			Thread_Sleep(1); continue;
+		} else if (res) {
+			net_recvError = res; return;
+		} else if (read == 0) {
+			/* Socket probably closed, timeout is checked on main thread */
+			Thread_Sleep(1); continue;
+		}
+
+		Mutex_Lock(net_recvMutex);
+		{
+			net_recvCount += read;
+		}
+		Mutex_Unlock(net_recvMutex);
+	}
+}
+
+static void NetRecv_Start(void) {
+	net_recvHead  = 0;
+	net_recvCount = 0;
+	net_recvStop  = false;
+	net_recvError = 0;
+
+	if (!Options_GetBool(OPT_NET_RECV_THREAD, false)) return;
+	if (!net_recvMutex) net_recvMutex = Mutex_Create("Net receive");
+
+	net_recvThreaded = true;
+	Thread_Run(&net_recvThread, NetRecv_ThreadLoop, 64 * 1024, "Net receive");
+}
+
+static void NetRecv_Stop(void) {
+	if (!net_recvThreaded) return;
+	net_recvStop = true;
+	Thread_Join(net_recvThread);
+
+	net_recvThread   = NULL;
+	net_recvThreaded = false;
+}
+
+/* Moves data from the receive queue. Errors are only returned once all queued data has been read */
+static cc_result NetRecv_Read(cc_uint8* data, cc_uint32 count, cc_uint32* read) {
+	cc_uint32 first, head;
+	cc_result res;
+
+	Mutex_Lock(net_recvMutex);
+	{
+		count = min(count, net_recvCount);
+		head  = net_recvHead;
+		res   = net_recvCount ? 0 : net_recvError;
+	}
+	Mutex_Unlock(net_recvMutex);
+
+	/* The receive thread only writes to the free part of the queue, so can copy outside the lock */
+	first = min(count, NET_RECV_SIZE - head);
+	Mem_Copy(data, &net_recvBuffer[head], first);
+	Mem_Copy(data + first, net_recvBuffer, count - first);
+
+	Mutex_Lock(net_recvMutex);
+	{
+		net_recvHead   = (head + count) % NET_RECV_SIZE;
+		net_recvCount -= count;
+	}
+	Mutex_Unlock(net_recvMutex);
+
+	*read = count;
+	return res;
+}
+#else
+#define NET_RECV_MAX_DRAINS 1
+static const cc_bool net_recvThreaded = false;
+static void NetRecv_Start(void) { }
+static void NetRecv_Stop(void)  { }
+static cc_result NetRecv_Read(cc_uint8* data, cc_uint32 count, cc_uint32* read) { *read = 0; return 0; }
+#endif
+
 static void MPConnection_FinishConnect(void) {
 	net_connecting = false;
 	Event_RaiseVoid(&NetEvents.Connected);
 	Event_RaiseFloat(&WorldEvents.Loading, 0.0f);
 
-	net_readCurrent = net_readBuffer;
-	net_lastPacket  = Game.Time;
+	net_readHead   = 0;
+	net_readCount  = 0;
+	net_writeCount = 0;
+	net_lastPacket = Game.Time;
+	NetStats_Reset();
+
+	if (!net_replaying) {
+		NetCapture_Open();
+		NetRecv_Start();
+	}
 	Classic_SendLogin();
 }
 
@@ -308,6 +591,12 @@ static void MPConnection_BeginConnect(void) {
 	Blocks.CanPlace[BLOCK_STILL_WATER] = false; Blocks.CanDelete[BLOCK_STILL_WATER] = false;
 	Blocks.CanPlace[BLOCK_BEDROCK] = false;     Blocks.CanDelete[BLOCK_BEDROCK] = false;
 	
+	if (NetReplay_Open()) {
+		Server.Disconnected = false;
+		MPConnection_FinishConnect();
+		return;
+	}
+	
 	res = Socket_ParseAddress(&Server.Address, Server.Port, addrs, &numValidAddrs);
 	if (res == ERR_INVALID_ARGUMENT) {
 		MPConnection_Fail(&invalid_reason); return;
@@ -376,66 +665,162 @@ static void DisconnectInvalidOpcode(cc_uint8 opcode) {
 	Game_Disconnect(&title, &tmp); return;
 }
 
-static void MPConnection_Tick(struct ScheduledTask* task) {
+static void MPConnection_ReadPackets(void) {
+	struct NetOpcodeStats* stats;
 	Net_Handler handler;
-	cc_uint8* readEnd;
-	cc_uint8* readCur;
-	cc_uint32 read;
-	int i, remaining;
+	cc_uint8* packet;
+	cc_uint32 size, wrapped;
+	cc_uint64 beg, end;
+	cc_uint8 opcode;
+
+	while (net_readCount) {
+		opcode = net_readBuffer[net_readHead];
+
+		/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
+		if (cpe_needD3Fix && lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
+			Platform_LogConst("Skipping invalid HackControl byte from D3 server");
+			net_readHead = (net_readHead + 1) % NET_READ_SIZE;
+			net_readCount--;
+			LocalPlayer_ResetJumpVelocity(Entities.CurPlayer);
+			continue;
+		}
+
+		/* Protocol packets might be split up across TCP packets */
+		/* If so, leave the unprocessed bytes to be combined with subsequently read TCP packet data */
+		size = Protocol.Sizes[opcode];
+		if (size > net_readCount) break;
+		handler = Protocol.Handlers[opcode];
+		if (!handler) { DisconnectInvalidOpcode(opcode); return; }
+
+		packet = &net_readBuffer[net_readHead];
+		if (net_readHead + size > NET_READ_SIZE) {
+			wrapped = net_readHead + size - NET_READ_SIZE;
+			Mem_Copy(&net_readBuffer[NET_READ_SIZE], net_readBuffer, wrapped);
+		}
+
+		lastOpcode = opcode;
+		net_readHead   = (net_readHead + size) % NET_READ_SIZE;
+		net_readCount -= size;
+
+		beg = Stopwatch_Measure();
+		handler(packet + 1); /* skip opcode */
+		end = Stopwatch_Measure();
+
+		stats = &NetStats.Recv[opcode];
+		stats->count++;
+		stats->bytes       += size;
+		stats->handlerTime += Stopwatch_ElapsedMicroseconds(beg, end);
+	}
+}
+
+static void MPConnection_WriteAll(const cc_uint8* data, cc_uint32 len) {
+	cc_uint32 wrote;
 	cc_result res;
+	int tries = 0;
 
-	if (Server.Disconnected) return;
-	if (net_connecting) { MPConnection_TickConnect(); return; }
+	while (len) {
+		res = Socket_Write(net_socket, data, len, &wrote);
+		/* If sending would block (send buffer full), retry for a bit up to 10 seconds */
+		/* TODO: Avoid doing this and manually buffer data when this happens */
+		if (res && tries < 1000 && (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock)) {
+			Thread_Sleep(10);
+			tries++;
+			continue;
+		}
+
+		/* NOTE: Not immediately disconnecting here, as otherwise we sometimes miss out on kick messages */
+		if (res)    { net_writeFailure = res;                  return; }
+		if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; return; }
+
+		data += wrote; len -= wrote;
+	}
+}
+
+static void MPConnection_FlushWrites(void) {
+	if (!net_writeCount || Server.Disconnected) return;
+	MPConnection_WriteAll(net_writeBuffer, net_writeCount);
+	net_writeCount = 0;
+}
+
+static void MPConnection_TickReplay(void) {
+	cc_uint32 read, tail, avail;
+	cc_result res;
+	/* Stay in replay mode after the end of the capture until disconnected, */
+	/*  as otherwise the next tick would try to read from a socket that was never opened */
+	if (net_replayDone) return;
+
+	/* When replaying as fast as possible, process the entire capture at once */
+	while (!net_replayDone && !Server.Disconnected) {
+		tail  = (net_readHead + net_readCount) % NET_READ_SIZE;
+		avail = min(NET_READ_SIZE - tail, NET_READ_SIZE - net_readCount);
+		res   = NetReplay_Read(&net_readBuffer[tail], avail, &read);
+
+		if (res) { DisconnectReadFailed(res); return; }
+		if (!read) break;
+
+		net_readCount += read;
+		MPConnection_ReadPackets();
+	}
+
+	if (!net_replayDone) return;
+	NetReplay_Report();
+	net_replayFile.Close(&net_replayFile);
+}
 
+/* Reads and processes received data, returning whether more data might be immediately available */
+static cc_bool MPConnection_Receive(void) {
+	cc_uint32 read, tail, avail;
+	cc_result res;
+
+	/* Read into the free space after the last received byte, up to the end of the buffer */
+	tail = (net_readHead + net_readCount) % NET_READ_SIZE;
+	avail = min(NET_READ_SIZE - tail, NET_READ_SIZE - net_readCount);
 	/* NOTE: using a read call that is a multiple of 4096 (appears to?) improve read performance */	
-	res = Socket_Read(net_socket, net_readCurrent, 4096 * 4, &read);
+	avail = min(avail, 4096 * 4);
+
+	if (net_recvThreaded) {
+		res = NetRecv_Read(&net_readBuffer[tail], avail, &read);
+	} else {
+		res = Socket_Read(net_socket, &net_readBuffer[tail], avail, &read);
+	}
 	
 	if (res) {
 		/* 'no data available for non-blocking read' is an expected error */
 		if (res == ReturnCode_SocketInProgess)  res = 0;
 		if (res == ReturnCode_SocketWouldBlock) res = 0;
 
-		if (res) { DisconnectReadFailed(res); return; }
+		if (res) { DisconnectReadFailed(res); }
+		return false;
 	} else if (read == 0) {
 		/* recv only returns 0 read when socket is closed.. probably? */
 		/* Over 30 seconds since last packet, connection probably dropped */
 		/* TODO: Should this be checked unconditonally instead of just when read = 0 ? */
-		if (net_lastPacket + 30 < Game.Time) { MPConnection_Disconnect(); return; }
+		if (net_lastPacket + 30 < Game.Time) { MPConnection_Disconnect(); }
+		return false;
 	} else {
-		readCur        = net_readBuffer;
-		readEnd        = net_readCurrent + read;
+		NetCapture_Write(&net_readBuffer[tail], read);
+		net_readCount += read;
 		net_lastPacket = Game.Time;
+		MPConnection_ReadPackets();
+		return read == avail;
+	}
+}
 
-		while (readCur < readEnd) {
-			cc_uint8 opcode = readCur[0];
-
-			/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
-			if (cpe_needD3Fix && lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
-				Platform_LogConst("Skipping invalid HackControl byte from D3 server");
-				readCur++;
-				LocalPlayer_ResetJumpVelocity(Entities.CurPlayer);
-				continue;
-			}
-
-			if (readCur + Protocol.Sizes[opcode] > readEnd) break;
-			handler = Protocol.Handlers[opcode];
-			if (!handler) { DisconnectInvalidOpcode(opcode); return; }
+static void MPConnection_Tick(struct ScheduledTask* task) {
+	int i;
+	if (Server.Disconnected) return;
+	if (net_connecting) { MPConnection_TickConnect(); MPConnection_FlushWrites(); return; }
 
-			lastOpcode = opcode;
-			handler(readCur + 1); /* skip opcode */
-			readCur += Protocol.Sizes[opcode];
-		}
+	if (net_replaying) { MPConnection_TickReplay(); return; }
 
-		/* Protocol packets might be split up across TCP packets */
-		/* If so, copy last few unprocessed bytes back to beginning of buffer */
-		/* These bytes are then later combined with subsequently read TCP packet data */
-		remaining = (int)(readEnd - readCur);
-		for (i = 0; i < remaining; i++) 
-		{
-			net_readBuffer[i] = readCur[i];
-		}
-		net_readCurrent = net_readBuffer + remaining;
+	/* When data is received on a separate thread, a large burst may be queued up */
+	/*  so drain up to a bounded amount of it, leaving the remainder for later ticks */
+	for (i = 0; i < NET_RECV_MAX_DRAINS; i++) 
+	{
+		if (!MPConnection_Receive()) break;
+		if (!net_recvThreaded || Server.Disconnected) break;
 	}
+	if (Server.Disconnected) return;
 
 	if (net_writeFailure) {
 		Platform_Log1("Error from send: %e", &net_writeFailure);
@@ -443,33 +828,25 @@ static void MPConnection_Tick(struct ScheduledTask* task) {
 	}
 
 	/* Network is ticked 60 times a second. We only send position updates 20 times a second */
-	if ((ticks++ % 3) != 0) return;
-
-	TexturePack_CheckPending();
-	Protocol_Tick();
+	if ((ticks++ % 3) == 0) {
+		TexturePack_CheckPending();
+		Protocol_Tick();
+	}
+	MPConnection_FlushWrites();
 }
 
 static void MPConnection_SendData(const cc_uint8* data, cc_uint32 len) {
-	cc_uint32 wrote;
-	cc_result res;
-	int tries = 0;
-	if (Server.Disconnected) return;
-
-	while (len) {
-		res = Socket_Write(net_socket, data, len, &wrote);
-		/* If sending would block (send buffer full), retry for a bit up to 10 seconds */
-		/* TODO: Avoid doing this and manually buffer data when this happens */
-		if (res && tries < 1000 && (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock)) {
-			Thread_Sleep(10);
-			tries++;
-			continue;
-		}
+	if (Server.Disconnected || net_replaying) return;
+	if (net_writeCount + len > NET_WRITE_SIZE) MPConnection_FlushWrites();
 
-		/* NOTE: Not immediately disconnecting here, as otherwise we sometimes miss out on kick messages */
-		if (res)    { net_writeFailure = res;                  return; }
-		if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; return; }
+	NetStats.Sent[data[0]].count++;
+	NetStats.Sent[data[0]].bytes += len;
 
-		data += wrote; len -= wrote;
+	if (len > NET_WRITE_SIZE) {
+		MPConnection_WriteAll(data, len);
+	} else {
+		Mem_Copy(&net_writeBuffer[net_writeCount], data, len);
+		net_writeCount += len;
 	}
 }
 
@@ -482,7 +859,8 @@ static void MPConnection_Init(void) {
 	Server.SendBlock    = MPConnection_SendBlock;
 	Server.SendChat     = MPConnection_SendChat;
 	Server.SendData     = MPConnection_SendData;
-	net_readCurrent     = net_readBuffer;
+	net_readHead        = 0;
+	net_readCount       = 0;
 }
 #else
 static void MPConnection_Init(void) { SPConnection_Init(); }
@@ -543,6 +921,14 @@ static void OnClose(void) {
 		Ping_Reset();
 		if (Server.Disconnected) return;
 
+#ifdef CC_BUILD_NETWORKING
+		NetCapture_Close();
+		if (net_replaying) { 
+			NetReplay_Close(); 
+			Server.Disconnected = true; return; 
+		}
+		NetRecv_Stop();
+#endif
 		Socket_Close(net_socket);
 		Server.Disconnected = true;
 	}
@@ -19,6 +19,24 @@ void Ping_Update(int id);
 /* Calculates average ping time based on most recent ping entries */
 int Ping_AveragePingMS(void);
 
+/* Statistics for all packets with a particular opcode */
+struct NetOpcodeStats {
+	cc_uint32 count;       /* Number of packets */
+	cc_uint32 bytes;       /* Total size of the packets in bytes */
+	cc_uint64 handlerTime; /* Total time spent in the packet handler, in microseconds */
+};
+
+/* Per-opcode statistics for packets received from and sent to the server */
+/* NOTE: Data sent in one Server.SendData call is attributed to the opcode of its first packet */
+extern struct _NetStatsData {
+	struct NetOpcodeStats Recv[256];
+	struct NetOpcodeStats Sent[256];
+	/* Whether received packet rates are shown in the HUD */
+	cc_bool ShowInHUD;
+} NetStats;
+/* Resets all per-opcode statistics to 0 */
+void NetStats_Reset(void);
+
 /* Data for currently active connection to a server */
 CC_VAR extern struct _ServerConnectionData {
 	/* Begins connecting to the server */
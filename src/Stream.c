@@ -393,6 +393,28 @@ void Stream_WriteonlyCrc32(struct Stream* s, struct Stream* source) {
 	s->meta.crc32.crc32  = 0xFFFFFFFFUL;
 }
 
+static cc_result Stream_Crc32Read(struct Stream* stream, cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	struct Stream* source = stream->meta.crc32.source;
+	cc_uint32 i, crc32    = stream->meta.crc32.crc32;
+	cc_result res         = source->Read(source, data, count, modified);
+
+	for (i = 0; i < *modified; i++) {
+		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
+	}
+	stream->meta.crc32.crc32   = crc32;
+	stream->meta.crc32.length += *modified;
+	return res;
+}
+
+void Stream_ReadonlyCrc32(struct Stream* s, struct Stream* source) {
+	Stream_Init(s);
+	s->Read = Stream_Crc32Read;
+
+	s->meta.crc32.source = source;
+	s->meta.crc32.crc32  = 0xFFFFFFFFUL;
+	s->meta.crc32.length = 0;
+}
+
 
 /*########################################################################################################################*
 *-------------------------------------------------Read/Write primitives---------------------------------------------------*
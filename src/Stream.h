@@ -36,7 +36,7 @@ struct Stream {
 		struct { cc_uint8* cur; cc_uint32 left, length; cc_uint8* base; } mem;
 		struct { struct Stream* source; cc_uint32 left, length; } portion;
 		struct { cc_uint8* cur; cc_uint32 left, length; cc_uint8* base; struct Stream* source; cc_uint32 end; } buffered;
-		struct { struct Stream* source; cc_uint32 crc32; } crc32;
+		struct { struct Stream* source; cc_uint32 crc32, length; } crc32;
 	} meta;
 };
 
@@ -72,6 +72,9 @@ CC_API void Stream_ReadonlyBuffered(struct Stream* s, struct Stream* source, voi
 /* Wraps another Stream, calculating a running CRC32 as data is written. */
 /* To get the final CRC32, xor it with 0xFFFFFFFFUL */
 void Stream_WriteonlyCrc32(struct Stream* s, struct Stream* source);
+/* Wraps another Stream, calculating a running CRC32 as data is read. */
+/* To get the final CRC32, xor it with 0xFFFFFFFFUL. meta.crc32.length is the number of bytes read */
+void Stream_ReadonlyCrc32(struct Stream* s, struct Stream* source);
 
 /* Reads a little-endian 16 bit unsigned integer from memory. */
 cc_uint16 Stream_GetU16_LE(const cc_uint8* data);
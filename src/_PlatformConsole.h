@@ -35,6 +35,13 @@ void Mem_Free(void* mem) {
 void Directory_GetCachePath(cc_string* path) { }
 
 
+/*########################################################################################################################*
+*--------------------------------------------------------Threading--------------------------------------------------------*
+*#########################################################################################################################*/
+/* TODO: Query number of CPU cores (multithreaded compression is only used with more than 1) */
+int Thread_CpuCount(void) { return 1; }
+
+
 /*########################################################################################################################*
 *-----------------------------------------------------Process/Module------------------------------------------------------*
 *#########################################################################################################################*/